@@ -9,7 +9,9 @@
 #include "kaylordut/log/logger.h"
 #include "kaylordut/time/time_duration.h"
 #include "kaylordut/time/timeout.h"
+#include "result_sink.h"
 #include "rknn_pool.h"
+#include "v4l2_camera.h"
 
 struct ProgramOptions {
   std::string model_path;
@@ -20,6 +22,17 @@ struct ProgramOptions {
   int height;
   double fps;
   bool is_track = false;
+  std::vector<rknn_core_mask> core_masks;
+  // 设置之后使用V4L2 mmap采集，可以是/dev/videoN，也可以是录制的文件
+  std::string device;
+  std::string pixel_format = "mjpeg";
+  std::string output_video;     // 按顺序编码推理结果
+  std::string output_filename;  // 检测结果，.bin是二进制，其他是JSON lines
+  bool headless = false;        // 不显示
+  // 分割模型的掩码在检测结果中的编码
+  DetectionSink::MaskFormat mask_format = DetectionSink::MaskFormat::RLE;
+  bool parallel_postprocess = false;  // 用空闲的CPU核心并行解码一帧
+  bool pipeline = false;  // 上一帧后处理的时候提交下一帧给NPU
 };
 
 // 检查字符串是否表示有效的数字
@@ -36,6 +49,7 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
   static struct option longOpts[] = {
       {"model_path", required_argument, nullptr, 'm'},
       {"label_path", required_argument, nullptr, 'l'},
+      {"core_mask", required_argument, nullptr, 'c'},
       {"threads", required_argument, nullptr, 't'},
       {"camera_index", required_argument, nullptr, 'i'},
       {"width", required_argument, nullptr, 'w'},
@@ -43,10 +57,18 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
       {"fps", required_argument, nullptr, 'f'},
       {"help", no_argument, nullptr, '?'},
       {"track", no_argument, nullptr, 'T'},
+      {"device", required_argument, nullptr, 'd'},
+      {"pixel_format", required_argument, nullptr, 'p'},
+      {"output_video", required_argument, nullptr, 'O'},
+      {"output", required_argument, nullptr, 'o'},
+      {"mask_format", required_argument, nullptr, 'M'},
+      {"headless", no_argument, nullptr, 'H'},
+      {"parallel_postprocess", no_argument, nullptr, 'P'},
+      {"pipeline", no_argument, nullptr, 'A'},
       {nullptr, 0, nullptr, 0}};
 
   int c, optionIndex = 0;
-  while ((c = getopt_long(argc, argv, "m:l:t:i:w:h:f:?T", longOpts,
+  while ((c = getopt_long(argc, argv, "m:l:t:i:w:h:f:?Tc:d:p:O:o:HM:PA", longOpts,
                           &optionIndex)) != -1) {
     switch (c) {
       case 'm':
@@ -55,6 +77,12 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
       case 'l':
         options.label_path = optarg;
         break;
+      case 'c':
+        if (!parse_core_masks(optarg, &options.core_masks)) {
+          KAYLORDUT_LOG_ERROR("Invalid core mask: {}", optarg);
+          return false;
+        }
+        break;
       case 't':
         if (isNumber(optarg)) {
           options.thread_count = std::atoi(optarg);
@@ -118,19 +146,64 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
       case 'T':
         options.is_track = true;
         break;
+      case 'd':
+        options.device = optarg;
+        break;
+      case 'O':
+        options.output_video = optarg;
+        break;
+      case 'o':
+        options.output_filename = optarg;
+        break;
+      case 'H':
+        options.headless = true;
+        break;
+      case 'P':
+        options.parallel_postprocess = true;
+        break;
+      case 'A':
+        options.pipeline = true;
+        break;
+      case 'M':
+        if (!parse_mask_format(optarg, &options.mask_format)) {
+          KAYLORDUT_LOG_ERROR("Invalid mask format: {}", optarg);
+          return false;
+        }
+        break;
+      case 'p': {
+        uint32_t fourcc;
+        if (!parse_pixel_format(optarg, &fourcc)) {
+          KAYLORDUT_LOG_ERROR("Invalid pixel format: {}", optarg);
+          return false;
+        }
+        options.pixel_format = optarg;
+        break;
+      }
       case '?':
         std::cout << "Usage: " << argv[0]
                   << " [--model_path|-m model_path] [--camera_index|-i index] "
                      "[--width|-w width] [--height|-h height]"
                      "[--threads|-t thread_count] [--fps|-f framerate] "
-                     "[--label_path|-l label_path]\n";
+                     "[--label_path|-l label_path] "
+                     "[--core_mask|-c 0,1,2|0_1|0_1_2|auto] "
+                     "[--device|-d device] "
+                     "[--pixel_format|-p mjpeg|yuyv|nv12] "
+                     "[--output_video|-O video] [--output|-o detections] "
+                     "[--mask_format|-M rle|polygon|none] [--headless|-H] "
+                     "[--parallel_postprocess|-P] [--pipeline|-A]\n";
         exit(EXIT_SUCCESS);
       default:
         std::cout << "Usage: " << argv[0]
                   << " [--model_path|-m model_path] [--camera_index|-i index] "
                      "[--width|-w width] [--height|-h height]"
                      "[--threads|-t thread_count] [--fps|-f framerate] "
-                     "[--label_path|-l label_path]\n";
+                     "[--label_path|-l label_path] "
+                     "[--core_mask|-c 0,1,2|0_1|0_1_2|auto] "
+                     "[--device|-d device] "
+                     "[--pixel_format|-p mjpeg|yuyv|nv12] "
+                     "[--output_video|-O video] [--output|-o detections] "
+                     "[--mask_format|-M rle|polygon|none] [--headless|-H] "
+                     "[--parallel_postprocess|-P] [--pipeline|-A]\n";
         abort();
     }
   }
@@ -160,22 +233,56 @@ int main(int argc, char *argv[]) {
     return 1;
   }
   auto rknn_pool = std::make_unique<RknnPool>(
-      options.model_path, options.thread_count, options.label_path);
-  auto camera = std::make_unique<Camera>(
-      options.camera_index, cv::Size(options.width, options.height),
-      options.fps);
-  ImageProcess image_process(options.width, options.height, 640,
-                             options.is_track, options.fps);
-  //  cv::VideoWriter video_writer(
-  //      getCurrentTimeStr() + ".mkv", cv::VideoWriter::fourcc('X', '2', '6',
-  //      '4'), options.fps, cv::Size(options.width, options.height), true);
-  //  if (!video_writer.isOpened()) {
-  //    KAYLORDUT_LOG_ERROR("Open the output video file error");
-  //    return -1;
-  //  }
-  std::unique_ptr<cv::Mat> image;
-  std::shared_ptr<cv::Mat> image_res;
-  cv::namedWindow("Video", cv::WINDOW_AUTOSIZE);
+      options.model_path, options.thread_count, options.label_path,
+      options.core_masks);
+  // 先确定流水线的深度，辅助线程的数量取决于推理线程的数量
+  if (options.pipeline) {
+    rknn_pool->SetPipelineDepth(2);
+  }
+  bool parallel_postprocess =
+      options.parallel_postprocess && rknn_pool->SetParallelPostProcess(true);
+  std::unique_ptr<Camera> camera;
+  std::unique_ptr<V4l2Camera> v4l2_camera;
+  if (options.device.empty()) {
+    camera = std::make_unique<Camera>(options.camera_index,
+                                      cv::Size(options.width, options.height),
+                                      options.fps, options.pixel_format);
+    options.width = camera->get_size().width;
+    options.height = camera->get_size().height;
+  } else {
+    // 采集线程独立运行，帧直接交给推理池，在推理线程里解码
+    uint32_t fourcc;
+    parse_pixel_format(options.pixel_format, &fourcc);
+    v4l2_camera = std::make_unique<V4l2Camera>(
+        options.device, cv::Size(options.width, options.height), options.fps,
+        fourcc);
+    options.width = v4l2_camera->get_size().width;
+    options.height = v4l2_camera->get_size().height;
+  }
+  // 既不显示也不录像时没有人使用绘制的图像，只输出检测结果
+  bool render = !options.headless || !options.output_video.empty();
+  int stream_id = rknn_pool->AddStream(
+      options.width, options.height, options.is_track, options.fps, 1, 0,
+      std::chrono::milliseconds(500), render);
+  // 结果的输出都在各自的线程里，主循环只负责采集和分发
+  std::vector<std::unique_ptr<ResultSink>> sinks;
+  if (!options.headless) {
+    sinks.push_back(std::make_unique<DisplaySink>("Video"));
+  }
+  if (!options.output_video.empty()) {
+    sinks.push_back(std::make_unique<VideoSink>(
+        options.output_video, options.fps,
+        cv::Size(options.width, options.height)));
+  }
+  if (!options.output_filename.empty()) {
+    auto detection_sink = std::make_unique<DetectionSink>(
+        options.output_filename, get_detection_format(options.output_filename));
+    detection_sink->set_mask_format(options.mask_format);
+    sinks.push_back(std::move(detection_sink));
+  }
+  std::shared_ptr<cv::Mat> image;
+  std::shared_ptr<RawFrame> raw_frame;
+  std::shared_ptr<InferenceResult> image_res;
   static int image_count = 0;
   static int image_res_count = 0;
   TimeDuration time_duration;
@@ -184,13 +291,27 @@ int main(int argc, char *argv[]) {
   while ((!timeout.isTimeout()) || (image_count != image_res_count)) {
     auto func = [&] {
       if (!timeout.isTimeout()) {
-        image = camera->GetNextFrame();
+        if (v4l2_camera == nullptr) {
+          // YUV格式取原始数据，交给推理线程一次完成转换和letterbox
+          if (camera->is_raw()) {
+            raw_frame = camera->GetNextRawFrame();
+          } else {
+            image = camera->GetNextFrame();
+          }
+        } else {
+          // 只短暂等待新的帧，保证结果能及时取走
+          raw_frame = v4l2_camera->GetNextFrame(std::chrono::milliseconds(5));
+        }
       }
       if (image != nullptr) {
-        rknn_pool->AddInferenceTask(std::move(image), image_process);
+        rknn_pool->AddInferenceTask(stream_id, std::move(image));
         image_count++;
       }
-      image_res = rknn_pool->GetImageResultFromQueue();
+      if (raw_frame != nullptr) {
+        rknn_pool->AddInferenceTask(stream_id, std::move(raw_frame));
+        image_count++;
+      }
+      image_res = rknn_pool->GetResultFromQueue(stream_id);
       if (image_res != nullptr) {
         image_res_count++;
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -200,9 +321,9 @@ int main(int argc, char *argv[]) {
             "{}ms",
             image_count, image_res_count, image_count - image_res_count,
             duration.count());
-        cv::imshow("Video", *image_res);
-        //        video_writer.write(*image_res);
-        cv::waitKey(1);
+        for (auto &sink : sinks) {
+          sink->Push(image_res);
+        }
       }
     };
     func();
@@ -214,8 +335,14 @@ int main(int argc, char *argv[]) {
       "Process {} frames, total time is {}ms, average frame rate is {}",
       image_res_count, duration_total_time.count(),
       image_res_count * 1000.0 / duration_total_time.count());
-  //  video_writer.release();
+  auto stats = rknn_pool->GetStreamStats(stream_id);
+  KAYLORDUT_LOG_INFO(
+      "fps is {}, latency is {}ms, dropped {} frames, parallel post process "
+      "is {}",
+      stats.fps, stats.latency_ms, stats.dropped,
+      parallel_postprocess ? "on" : "off");
+  // 等待视频和检测结果写完
+  sinks.clear();
   rknn_pool.reset();
-  cv::destroyAllWindows();
   return 0;
 }
\ No newline at end of file
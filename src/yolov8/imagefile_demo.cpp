@@ -1,8 +1,10 @@
 #include <cctype>  // 用于检查字符是否为数字
 #include <cerrno>  // 用于检查 strtol 和 strtod 的错误
 
+#include "fstream"
 #include "getopt.h"
 #include "image_process.h"
+#include "jpeg_decoder.h"
 #include "kaylordut/log/logger.h"
 #include "kaylordut/time/run_once.h"
 #include "kaylordut/time/time_duration.h"
@@ -14,6 +16,7 @@ struct ProgramOptions {
   std::string input_filename;
   int thread_count;
   double framerate;
+  std::vector<rknn_core_mask> core_masks;
 };
 
 // 检查字符串是否表示有效的数字
@@ -29,12 +32,13 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
   static struct option longOpts[] = {
       {"model_path", required_argument, nullptr, 'm'},
       {"label_path", required_argument, nullptr, 'l'},
+      {"core_mask", required_argument, nullptr, 'c'},
       {"input_filename", required_argument, nullptr, 'i'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, 0, nullptr, 0}};
 
   int c, optionIndex = 0;
-  while ((c = getopt_long(argc, argv, "m:l:t:f:i:h", longOpts, &optionIndex)) !=
+  while ((c = getopt_long(argc, argv, "m:l:t:f:i:hc:", longOpts, &optionIndex)) !=
          -1) {
     switch (c) {
       case 'm':
@@ -43,6 +47,12 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
       case 'l':
         options.label_path = optarg;
         break;
+      case 'c':
+        if (!parse_core_masks(optarg, &options.core_masks)) {
+          KAYLORDUT_LOG_ERROR("Invalid core mask: {}", optarg);
+          return false;
+        }
+        break;
       case 'i':
         options.input_filename = optarg;
         break;
@@ -50,7 +60,8 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
         std::cout << "Usage: " << argv[0]
                   << " [--model_path|-m model_path] [--input_filename|-i "
                      "input_filename] "
-                     "[--label_path|-l label_path]\n";
+                     "[--label_path|-l label_path] "
+                     "[--core_mask|-c 0,1,2|0_1|0_1_2|auto]\n";
         exit(EXIT_SUCCESS);
       case '?':
         // 错误消息由getopt_long自动处理
@@ -59,7 +70,8 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
         std::cout << "Usage: " << argv[0]
                   << " [--model_path|-d model_path] [--input_filename|-i "
                      "input_filename] "
-                     "[--label_path|-l label_path]\n";
+                     "[--label_path|-l label_path] "
+                     "[--core_mask|-c 0,1,2|0_1|0_1_2|auto]\n";
         abort();
     }
   }
@@ -81,28 +93,58 @@ int main(int argc, char *argv[]) {
     return 1;
   }
   auto rknn_pool = std::make_unique<RknnPool>(
-      options.model_path, options.thread_count, options.label_path);
-  std::unique_ptr<cv::Mat> image = std::make_unique<cv::Mat>();
-  *image = cv::imread(options.input_filename);
-  if (image->empty()) {
-    KAYLORDUT_LOG_ERROR("read image error");
-    return -1;
+      options.model_path, options.thread_count, options.label_path,
+      options.core_masks);
+  // JPEG交给推理线程按DCT缩放解码，只需要读取文件头得到原图大小
+  std::ifstream file(options.input_filename, std::ios::binary);
+  auto data = std::make_shared<std::vector<uint8_t>>(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  int width = 0, height = 0;
+  JpegDecoder decoder;
+  std::shared_ptr<RawFrame> raw_frame;
+  std::unique_ptr<cv::Mat> image;
+  if (decoder.ReadHeader(data->data(), data->size(), &width, &height)) {
+    uint32_t fourcc;
+    parse_pixel_format("mjpeg", &fourcc);
+    // deleter持有文件数据，帧解码之后一起释放
+    raw_frame = std::shared_ptr<RawFrame>(
+        new RawFrame{data->data(), data->size(), fourcc, width, height,
+                     std::chrono::steady_clock::now(), 0},
+        [data](RawFrame *frame) { delete frame; });
+  } else {
+    image = std::make_unique<cv::Mat>(cv::imread(options.input_filename));
+    if (image->empty()) {
+      KAYLORDUT_LOG_ERROR("read image error");
+      return -1;
+    }
+    width = image->cols;
+    height = image->rows;
   }
-  ImageProcess image_process(image->cols, image->rows, 640);
+  int stream_id = rknn_pool->AddStream(width, height);
 
-  std::shared_ptr<cv::Mat> image_res;
+  std::shared_ptr<InferenceResult> image_res;
   uint8_t running_flag = 0;
   cv::namedWindow("Image demo", cv::WINDOW_AUTOSIZE);
   static int image_count = 0;
   static int image_res_count = 0;
-  rknn_pool->AddInferenceTask(std::move(image), image_process);
+  if (raw_frame != nullptr) {
+    rknn_pool->AddInferenceTask(stream_id, std::move(raw_frame));
+  } else {
+    rknn_pool->AddInferenceTask(stream_id, std::move(image));
+  }
   while (image_res == nullptr) {
-    image_res = rknn_pool->GetImageResultFromQueue();
+    image_res = rknn_pool->GetResultFromQueue(stream_id);
   }
-  cv::imshow("Image demo", *image_res);
+  cv::imshow("Image demo", *image_res->image);
   cv::waitKey(0);
   rknn_pool.reset();
   cv::destroyAllWindows();
-  cv::imwrite("result_" + options.input_filename, *image_res);
+  // JPEG按DCT缩放解码，绘制的结果比原图小，保存之前放大回原图的大小
+  cv::Mat result = *image_res->image;
+  if (result.cols != width || result.rows != height) {
+    cv::resize(result, result, cv::Size(width, height), 0, 0,
+               cv::INTER_LINEAR);
+  }
+  cv::imwrite("result_" + options.input_filename, result);
   return 0;
 }
\ No newline at end of file
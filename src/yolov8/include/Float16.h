@@ -1,6 +1,15 @@
 #ifndef _RKNPU2_RKNN_MATMUL_API_DEMO_H_
 #define _RKNPU2_RKNN_MATMUL_API_DEMO_H_
 
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__F16C__)
+#include <immintrin.h>
+#endif
+
 namespace rknpu2 {
 
 using ushort = unsigned short;
@@ -168,6 +177,75 @@ class float16 {
   ushort w = 0;
 };
 
+// 逐个转换，全部65536个输入都和NEON/F16C的硬件转换逐位一致
+// 和float16::operator float只在signaling NaN上不同：operator float不设置
+// quiet位，硬件和这里都把它变成quiet NaN，payload保持不变
+inline float to_fp32(ushort h) {
+  if ((h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0) {
+    suf32 out;
+    out.u = ((unsigned)(h & 0x8000) << 16) | 0x7fc00000 |
+            ((unsigned)(h & 0x03ff) << 13);
+    return out.f;
+  }
+  return float16::fromBits(h);
+}
+
+// fp32到fp16，to_fp32的反方向：推理和后处理只读取fp16，这两个函数用来构造
+// fp16的张量（例如test/output_layout_test.cpp中的输出），结果和NEON/F16C的
+// 硬件转换逐位一致：舍入到最近的偶数，NaN变成quiet NaN并保留payload的高位
+// （float16::bits统一返回0x7e00）
+inline ushort to_fp16(float x) {
+  suf32 in;
+  in.f = x;
+  if ((in.u & 0x7fffffff) > 0x7f800000) {
+    return (ushort)(((in.u >> 16) & 0x8000) | 0x7e00 | ((in.u >> 13) & 0x03ff));
+  }
+  return float16::bits(x);
+}
+
+// 批量把fp16（位模式）转换成fp32，aarch64使用NEON的vcvt，
+// x86编译时打开F16C（-mf16c）使用vcvtph2ps，剩下不足8个的逐个转换
+inline void to_fp32(const ushort* src, float* dst, size_t count) {
+  size_t i = 0;
+#if defined(__aarch64__)
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t h = vld1q_u16(src + i);
+    float16x8_t f16 = vreinterpretq_f16_u16(h);
+    vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(f16)));
+    vst1q_f32(dst + i + 4, vcvt_high_f32_f16(f16));
+  }
+#elif defined(__F16C__)
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = to_fp32(src[i]);
+  }
+}
+
+// 批量把fp32转换成fp16（位模式），舍入到最近的偶数
+inline void to_fp16(const float* src, ushort* dst, size_t count) {
+  size_t i = 0;
+#if defined(__aarch64__)
+  for (; i + 8 <= count; i += 8) {
+    float16x4_t low = vcvt_f16_f32(vld1q_f32(src + i));
+    float16x8_t f16 = vcvt_high_f16_f32(low, vld1q_f32(src + i + 4));
+    vst1q_u16(dst + i, vreinterpretq_u16_f16(f16));
+  }
+#elif defined(__F16C__)
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = to_fp16(src[i]);
+  }
+}
+
 }  // namespace rknpu2
 
 #endif /* _RKNPU2_RKNN_MATMUL_API_DEMO_H_ */
\ No newline at end of file
@@ -4,14 +4,24 @@
 
 #pragma once
 #include "opencv2/opencv.hpp"
+#include "raw_frame.h"
 
 class Camera {
  public:
-  Camera(uint16_t index, cv::Size size, double framerate);
+  // pixel_format为"yuyv"或者"nv12"时不做颜色转换，用GetNextRawFrame取原始数据
+  Camera(uint16_t index, cv::Size size, double framerate,
+         const std::string &pixel_format = "mjpeg");
   ~Camera();
-  std::unique_ptr<cv::Mat> GetNextFrame();
+  // 帧来自FramePool，释放之后缓冲区回到池中
+  std::shared_ptr<cv::Mat> GetNextFrame();
+  std::shared_ptr<RawFrame> GetNextRawFrame();
+  bool is_raw();
+  cv::Size get_size();
 
  private:
   cv::Size size_;
   cv::VideoCapture capture_;
+  uint32_t fourcc_;
+  bool raw_{false};
+  uint64_t sequence_{0};
 };
@@ -4,11 +4,15 @@
 
 #pragma once
 #include "rknn_api.h"
+
+class ThreadPool;
 #define OBJ_NAME_MAX_SIZE 64
 #define OBJ_NUMB_MAX_SIZE 128
 #define OBJ_CLASS_NUM 80
 #define NMS_THRESH 0.8
 #define BOX_THRESH 0.5
+// NMS之前最多保留的候选数量，只有这些候选才解码检测框
+#define PRE_NMS_TOP_K 1000
 #define PROTO_CHANNEL (32)
 #define PROTO_HEIGHT (160)
 #define PROTO_WEIGHT (160)
@@ -66,8 +70,13 @@ typedef struct {
   int cls_id;
 } object_detect_result;
 
+// 每个实例一个掩码，只覆盖检测框（原图坐标）的区域，分辨率和原图相同
+// 行优先，每个像素0或1，第(y, x)个像素对应原图的(box.top + y, box.left + x)
+// 由后处理分配，通过release_seg_masks释放
 typedef struct {
   uint8_t *seg_mask;
+  int width;
+  int height;
 } object_segment_result;
 
 typedef struct {
@@ -80,13 +89,26 @@ typedef struct {
   object_pose_result results_pose[OBJ_NUMB_MAX_SIZE];
 } object_detect_result_list;
 
+// 输出张量的内存布局，第channel个通道、第cell个网格单元的下标是
+// (channel / c2) * plane * c2 + cell * c2 + channel % c2
+// NCHW的c2是1，NHWC的c2是通道数，NC1HWC2的c2由NPU决定（int8是16）
+typedef struct {
+  int plane;  // 网格单元的数量，H * W
+  int c2;
+} tensor_layout_t;
+
 typedef struct {
   rknn_context rknn_ctx;
   rknn_input_output_num io_num;
   rknn_tensor_attr *input_attrs;
-  rknn_tensor_attr *output_attrs;
+  rknn_tensor_attr *output_attrs;  // 逻辑上的NCHW属性，dims是[N, C, H, W]
+  tensor_layout_t *output_layouts;  // 输出在内存中的实际布局
   int model_channel;
   int model_width;
   int model_height;
   bool is_quant;
+  bool is_fp16;  // 非量化模型直接读取fp16的输出，不让运行时转换成fp32
+  int pre_nms_top_k;  // 小于等于0时不限制
+  // 后处理的辅助线程池，按分支和行并行解码，为空时在推理线程中解码
+  ThreadPool *decode_pool;
 } rknn_app_context_t;
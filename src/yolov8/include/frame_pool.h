@@ -0,0 +1,33 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "map"
+#include "memory"
+#include "mutex"
+#include "opencv2/opencv.hpp"
+#include "vector"
+
+// 采集、预处理和结果共用的帧缓冲池
+// 缓冲区按页对齐（同时满足cache line和DMA的要求），按字节数分级复用
+// 取出的cv::Mat由shared_ptr持有，最后一个引用释放时缓冲区回到池中，
+// 稳定运行之后不再有内存分配和缺页
+class FramePool {
+ public:
+  static FramePool &GetInstance();
+  std::shared_ptr<cv::Mat> Acquire(int rows, int cols, int type);
+  // 每一级最多缓存的空闲缓冲区个数，超出的直接释放
+  void set_max_free_per_class(size_t count);
+  size_t get_allocated_bytes();
+
+ private:
+  FramePool() = default;
+  void *AllocateBuffer(size_t size_class);
+  void ReleaseBuffer(void *buffer, size_t size_class);
+
+  std::map<size_t, std::vector<void *>> free_buffers_;
+  size_t max_free_per_class_{32};
+  size_t allocated_bytes_{0};
+  std::mutex mutex_;
+};
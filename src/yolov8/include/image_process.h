@@ -4,19 +4,34 @@
 
 #pragma once
 #include "BYTETracker.h"
-#include "mutex"
 #include "opencv2/opencv.hpp"
 #include "postprocess.h"
+#include "raw_frame.h"
+#include "vector"
 
 class ImageProcess {
  public:
-  ImageProcess(int width, int height, int target_size, bool is_track = false,
-               int framerate = 30);
-  std::unique_ptr<cv::Mat> Convert(const cv::Mat &src);
+  ImageProcess(int width, int height, int target_size, bool is_track = false);
+  // 结果来自FramePool，缩放直接写入letterbox的区域，不再有中间图像
+  std::shared_ptr<cv::Mat> Convert(const cv::Mat &src);
+  // YUYV/NV12一次遍历完成颜色转换、缩放（最近邻）和填充，直接写入模型输入
+  // dst是target_size x target_size的RGB
+  bool ConvertYuv(const RawFrame &frame, uint8_t *dst) const;
+  // ConvertYuv能否处理这一帧：格式是YUYV/NV12并且大小和这一路视频相同
+  bool CheckYuvFrame(const RawFrame &frame) const;
   const letterbox_t &get_letter_box();
+  // 原图缩放到letterbox里的大小，按比例解码时不需要比它更大的图像
+  cv::Size get_resized_size() const;
   void ImagePostProcess(cv::Mat &image, object_detect_result_list &od_results);
+  // image可以是按比例缩小解码的图像，检测结果是原图的坐标，绘制时再换算
+  // 跟踪需要按帧的顺序执行，由TrackingStage在单独的线程中调用
+  // image为空时只更新跟踪器，不绘制
+  void ProcessTrackImage(cv::Mat *image, object_detect_result_list &od_results,
+                         BYTETracker &tracker) const;
 
  private:
+  int width_;
+  int height_;
   double scale_;
   int padding_x_;
   int padding_y_;
@@ -24,11 +39,16 @@ class ImageProcess {
   int target_size_;
   letterbox_t letterbox_;
   bool is_track_;
-  std::unique_ptr<BYTETracker> tracker_;
-  std::mutex tracker_mutex_;
+  // letterbox区域内每一列、每一行对应的原图坐标
+  std::vector<int> map_x_;
+  std::vector<int> map_y_;
+  void ScaleResults(double scale_x, double scale_y,
+                    object_detect_result_list *od_results) const;
+  // 每个实例的掩码按类别的颜色混合到检测框内
+  void ProcessSegmentImage(cv::Mat &image,
+                           const object_detect_result_list &od_results) const;
   void ProcessDetectionImage(cv::Mat &image,
                              object_detect_result_list &od_results) const;
-  void ProcessTrackImage(cv::Mat &image, object_detect_result_list &od_results);
   void ProcessPoseImage(cv::Mat &image,
                         object_detect_result_list &od_results) const;
   void ProcessOBBImage(cv::Mat &image,
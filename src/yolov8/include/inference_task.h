@@ -0,0 +1,40 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "chrono"
+#include "common.h"
+#include "memory"
+#include "opencv2/opencv.hpp"
+#include "raw_frame.h"
+
+class ImageProcess;
+
+struct InferenceTask {
+  int stream_id;
+  uint64_t sequence;
+  std::shared_ptr<cv::Mat> image;
+  ImageProcess *image_process;
+  std::chrono::steady_clock::time_point enqueue_time;
+  // 采集到的原始帧，image为空时由推理线程解码
+  std::shared_ptr<RawFrame> raw_frame;
+  // 为false时只输出检测结果，预处理之后立即释放原图，结果中的image为空
+  bool render{true};
+};
+
+struct InferenceResult {
+  int stream_id;
+  uint64_t sequence;
+  // 只输出检测结果的视频流为空
+  std::shared_ptr<cv::Mat> image;
+  std::shared_ptr<object_detect_result_list> detections;
+  std::chrono::steady_clock::time_point enqueue_time;
+};
+
+struct StreamStats {
+  uint64_t frames;    // 已经输出结果的帧数
+  uint64_t dropped;   // 因为排队过长被丢弃的帧数
+  double fps;         // 最近的输出帧率
+  double latency_ms;  // 最近的端到端延时（入队或者原始帧出队到输出）
+};
@@ -0,0 +1,27 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "memory"
+#include "opencv2/opencv.hpp"
+#include "turbojpeg.h"
+
+// 使用libjpeg-turbo的DCT缩放，直接解码到接近letterbox的大小
+// 模型只需要640左右的输入，1080p的MJPEG按1/2解码可以省掉大部分IDCT和缩放的开销
+// 句柄不是线程安全的，每个线程使用自己的JpegDecoder
+class JpegDecoder {
+ public:
+  JpegDecoder();
+  ~JpegDecoder();
+  JpegDecoder(const JpegDecoder &) = delete;
+  JpegDecoder &operator=(const JpegDecoder &) = delete;
+  bool ReadHeader(const uint8_t *data, size_t size, int *width, int *height);
+  // 选择最小的缩放比例，保证解码后的宽高都不小于min_size，输出BGR
+  // min_size为空时按原图大小解码
+  std::shared_ptr<cv::Mat> Decode(const uint8_t *data, size_t size,
+                                  cv::Size min_size = cv::Size());
+
+ private:
+  tjhandle handle_;
+};
@@ -0,0 +1,48 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "opencv2/opencv.hpp"
+#include "string"
+#include "vector"
+
+// 标签的渲染：创建时把每个类别的名字和数字、小数点、百分号预先栅格化成
+// 掩码，绘制时只按颜色拷贝像素，不再逐帧格式化字符串和光栅化Hershey字体
+// 位置和cv::putText相同（origin是文字基线的左端），字符按各自的宽度依次排列
+class LabelRenderer {
+ public:
+  // with_class_names为true时同时栅格化每个类别的名字，需要在
+  // init_post_process之后创建
+  LabelRenderer(int font_face, double font_scale, int thickness,
+                bool with_class_names);
+  // 绘制"类别名 分数%"，分数保留一位小数
+  void DrawLabel(cv::Mat &image, int cls_id, float score, cv::Point origin,
+                 const cv::Scalar &color) const;
+  // 绘制非负整数，例如跟踪的id
+  void DrawNumber(cv::Mat &image, int number, cv::Point origin,
+                  const cv::Scalar &color) const;
+
+ private:
+  struct Glyph {
+    cv::Mat mask;  // CV_8UC1，非0的像素需要绘制
+    int ascent;    // 基线在掩码中的行
+    int left;      // origin在掩码中的列
+    int advance;   // 下一个字符的origin向右移动的距离
+  };
+  Glyph Rasterize(const std::string &text) const;
+  // 返回advance
+  int Blit(cv::Mat &image, const Glyph &glyph, cv::Point origin,
+           const cv::Scalar &color) const;
+  const Glyph *GetCharGlyph(char c) const;
+
+  int font_face_;
+  double font_scale_;
+  int thickness_;
+  std::vector<Glyph> class_glyphs_;  // "类别名 "
+  std::vector<Glyph> char_glyphs_;   // kCharset中的每个字符
+};
+
+// 轴对齐的矩形框，直接填充四条边，和cv::rectangle相同的线宽
+void draw_box(cv::Mat &image, const cv::Rect &rect, const cv::Scalar &color,
+              int thickness);
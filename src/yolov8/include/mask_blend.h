@@ -0,0 +1,22 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "stdint.h"
+
+// 分割掩码和图像的混合：out = (pixel * w + color * (256 - w) + 128) >> 8
+// w是原像素的权重（放大256倍），kMaskWeight = 128 即 alpha = 0.5
+// 不超过255，保证SIMD路径里可以用8位乘法，所有路径的结果完全一致
+static const int kMaskWeight = 128;
+
+// 颜色乘以权重再加上舍入项，按通道预先计算，color和bias都是BGR的顺序
+void mask_color_bias(const uint8_t color[3], uint16_t bias[3]);
+
+// 一行BGR像素和掩码混合，掩码为0的像素保持不变
+// aarch64使用NEON，x86编译时打开SSSE3（-mssse3）使用SSSE3，一次16个像素
+void blend_mask_row(uint8_t *pixel, const uint8_t *mask, int count,
+                    const uint16_t bias[3]);
+// 只用标量计算，blend_mask_row剩下不足16个像素的部分也使用它
+void blend_mask_row_scalar(uint8_t *pixel, const uint8_t *mask, int count,
+                           const uint16_t bias[3]);
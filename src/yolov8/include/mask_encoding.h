@@ -0,0 +1,21 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "opencv2/opencv.hpp"
+#include "stdint.h"
+#include "vector"
+
+// 分割结果的紧凑编码，输入是检测框内的实例掩码（0或1，行优先）
+
+// 游程编码：行优先，从0开始交替记录0和1的长度，第一个长度可以是0
+// 例如 0 0 1 1 1 0 编码为 2 3 1
+std::vector<uint32_t> encode_mask_rle(const uint8_t *mask, int width,
+                                      int height);
+
+// 外轮廓多边形，坐标加上offset（检测框的左上角）之后是原图坐标
+// epsilon是多边形近似允许的最大误差（像素），为0时保留所有的轮廓点
+std::vector<std::vector<cv::Point>> encode_mask_polygons(
+    const uint8_t *mask, int width, int height, cv::Point offset,
+    double epsilon = 1.0);
@@ -0,0 +1,24 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "string"
+
+// 只读映射整个.rknn模型文件，一个推理池只映射一次
+// 映射的页由所有进程共享，不需要像malloc + fread那样再复制一份
+class ModelFile {
+ public:
+  ModelFile(const std::string &path);
+  ~ModelFile();
+  ModelFile(const ModelFile &) = delete;
+  ModelFile &operator=(const ModelFile &) = delete;
+  bool IsValid() const;
+  // rknn_init的参数不是const，但是不会修改模型数据
+  void *get_data() const;
+  size_t get_size() const;
+
+ private:
+  void *data_{nullptr};
+  size_t size_{0};
+};
@@ -0,0 +1,42 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "chrono"
+#include "condition_variable"
+#include "mutex"
+#include "vector"
+
+// 根据每个上下文的在途任务数和最近的rknn_run耗时，把任务分配给负载最低的空闲上下文
+// Dispatch each frame to the least-loaded free context, based on the work in
+// flight and the recent rknn_run latency of every context. It does not depend
+// on the rknn runtime; test/npu_scheduler_test.cpp drives it with a stub
+// runtime that simulates per-core latency.
+// 预计完成时间是(in_flight + 1) * 平均耗时。max_in_flight为1时只有空闲的上下文
+// 可选，这个公式退化成“选择最快的空闲上下文”；快核心处理更多的帧，是因为它更早
+// 空闲下来。只有max_in_flight大于1（流水线模式）时，才会拿排队的快核心和空闲的
+// 慢核心比较。
+class NpuScheduler {
+ public:
+  NpuScheduler(int context_num, int max_in_flight = 1);
+  // 阻塞直到有空闲的上下文，返回上下文的id
+  int Acquire();
+  void Release(int context_id, std::chrono::microseconds run_time);
+  int get_in_flight(int context_id);
+  double get_average_run_time_ms(int context_id);
+
+ private:
+  struct ContextLoad {
+    int in_flight{0};
+    double average_us{0.0};  // 指数加权平均的运行耗时
+    uint64_t runs{0};
+  };
+  int SelectContext() const;
+
+  std::vector<ContextLoad> loads_;
+  int max_in_flight_{1};
+  int next_{0};  // 负载相同时轮流选择，避免总是落在第一个上下文
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
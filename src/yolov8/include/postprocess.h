@@ -34,4 +34,6 @@ int post_process_pose(rknn_app_context_t *app_ctx, rknn_output *outputs,
                       letterbox_t *letter_box, float conf_threshold,
                       float nms_threshold,
                       object_detect_result_list *od_results);
+// 释放分割模型每个实例的掩码
+void release_seg_masks(object_detect_result_list *od_results);
 int clamp(float val, int min, int max);
@@ -0,0 +1,33 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "chrono"
+#include "memory"
+#include "opencv2/opencv.hpp"
+#include "string"
+
+// 采集到的原始帧（MJPEG/YUYV/NV12），data直接指向采集缓冲区
+// 帧由shared_ptr持有，最后一个引用释放时缓冲区归还给采集设备
+struct RawFrame {
+  uint8_t *data;
+  size_t size;      // 有效数据的字节数
+  uint32_t fourcc;  // V4L2的像素格式
+  int width;
+  int height;
+  // 出队的时间，作为推理任务的入队时间
+  std::chrono::steady_clock::time_point timestamp;
+  uint64_t sequence;
+};
+
+// 解析像素格式字符串："mjpeg"、"yuyv"、"nv12"
+bool parse_pixel_format(const std::string &str, uint32_t *fourcc);
+
+// YUYV和NV12可以由ImageProcess::ConvertYuv直接写入模型输入
+bool is_yuv_format(uint32_t fourcc);
+
+// 在推理线程里把原始帧解码成BGR图像，失败返回nullptr
+// JPEG按DCT缩放解码到不小于min_size的大小，检测结果仍然是原图的坐标
+std::shared_ptr<cv::Mat> DecodeRawFrame(const RawFrame &frame,
+                                        cv::Size min_size = cv::Size());
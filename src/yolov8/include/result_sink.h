@@ -0,0 +1,122 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "condition_variable"
+#include "deque"
+#include "fstream"
+#include "inference_task.h"
+#include "memory"
+#include "mutex"
+#include "opencv2/opencv.hpp"
+#include "string"
+#include "thread"
+#include "vector"
+
+// 结果的输出端：每个sink有自己的线程和有界队列，编码、写文件和显示都不在
+// 取结果的主循环里执行，也不会阻塞推理
+// 队列满时，drop_oldest的sink丢弃最旧的结果，否则Push等待，保证不丢帧
+class ResultSink {
+ public:
+  ResultSink(size_t capacity, bool drop_oldest);
+  virtual ~ResultSink();
+  void Push(std::shared_ptr<InferenceResult> result);
+  // 处理完队列里剩下的结果之后结束线程，派生类需要在析构函数里调用
+  void Stop();
+  uint64_t get_dropped();
+
+ protected:
+  // 派生类初始化完成之后调用
+  void Start();
+  virtual void Consume(const InferenceResult &result) = 0;
+
+ private:
+  void Loop();
+
+  size_t capacity_;
+  bool drop_oldest_;
+  std::deque<std::shared_ptr<InferenceResult>> queue_;
+  uint64_t dropped_{0};
+  bool stop_{false};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread thread_;
+};
+
+// 按结果的顺序编码成视频，不丢帧
+class VideoSink : public ResultSink {
+ public:
+  VideoSink(const std::string &filename, double fps, cv::Size size,
+            size_t capacity = 64);
+  ~VideoSink() override;
+  bool IsOpened();
+
+ protected:
+  void Consume(const InferenceResult &result) override;
+
+ private:
+  cv::VideoWriter writer_;
+  cv::Size size_;
+  cv::Mat resized_;
+};
+
+// 检测结果写到文件，不丢帧，坐标是原图的坐标
+// JSON_LINES：每帧一行 {"stream":0,"frame":N,"time":t,"detections":[...]}
+//         分割模型的检测框内的掩码按mask_format输出：
+//         RLE "mask":{"size":[w,h],"counts":[...]}（见encode_mask_rle）
+//         POLYGON "polygons":[[x0,y0,x1,y1,...],...]（原图坐标）
+// BINARY：每帧一个头 {int32 stream, uint64 frame, int32 count}，之后count个
+//         {int32 cls_id, float prop, int32 box[4], float theta}，小端
+//         box是left/top/right/bottom，OBB模型是x/y/w/h加上theta，不包含掩码
+class DetectionSink : public ResultSink {
+ public:
+  enum class Format { JSON_LINES, BINARY };
+  enum class MaskFormat { NONE, RLE, POLYGON };
+  // fps大于0时按帧号换算时间，否则time为入队时刻相对第一帧的秒数
+  DetectionSink(const std::string &filename, Format format, double fps = 0.0,
+                size_t capacity = 256);
+  ~DetectionSink() override;
+  bool IsOpened();
+  // 需要在第一次Push之前设置
+  void set_mask_format(MaskFormat mask_format);
+
+ protected:
+  void Consume(const InferenceResult &result) override;
+
+ private:
+  void WriteJson(const InferenceResult &result);
+  void WriteBinary(const InferenceResult &result);
+  void WriteMask(const object_detect_result_list &od_results, int index);
+
+  std::ofstream output_;
+  Format format_;
+  MaskFormat mask_format_{MaskFormat::RLE};
+  double fps_;
+  bool has_first_time_{false};
+  std::chrono::steady_clock::time_point first_time_;
+};
+
+// 按扩展名选择格式：.bin是BINARY，其他是JSON_LINES
+DetectionSink::Format get_detection_format(const std::string &filename);
+// rle、polygon或者none
+bool parse_mask_format(const std::string &str,
+                       DetectionSink::MaskFormat *mask_format);
+
+// 所有视频流共用一个显示sink：HighGUI不是线程安全的，窗口的创建、imshow和
+// waitKey都只在这个sink的线程里调用
+// 每一路按结果的stream_id显示在自己的窗口里，0号是window_name，其他的是
+// "window_name N"；队列按路数分配，来不及显示的帧丢弃最旧的
+class DisplaySink : public ResultSink {
+ public:
+  DisplaySink(const std::string &window_name, size_t stream_num = 1);
+  ~DisplaySink() override;
+
+ protected:
+  void Consume(const InferenceResult &result) override;
+
+ private:
+  std::string window_name_;
+  // 已经创建的窗口，下标是stream_id
+  std::vector<std::string> windows_;
+};
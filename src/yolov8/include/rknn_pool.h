@@ -3,32 +3,78 @@
 //
 
 #pragma once
+#include "chrono"
 #include "image_process.h"
+#include "model_file.h"
+#include "npu_scheduler.h"
 #include "opencv2/opencv.hpp"
-#include "queue"
+#include "stream_registry.h"
 #include "threadpool.h"
 #include "yolov8.h"
+
 class RknnPool {
  public:
+  // core_masks按上下文循环使用，为空时每个上下文依次绑定到核心0/1/2
   RknnPool(const std::string model_path, const int thread_num,
-           const std::string label_path);
+           const std::string label_path,
+           const std::vector<rknn_core_mask> core_masks = {});
   ~RknnPool();
   void Init();
   void DeInit();
-  void AddInferenceTask(std::shared_ptr<cv::Mat> src,
-                        ImageProcess &image_process);
-  int get_model_id();
-  std::shared_ptr<cv::Mat> GetImageResultFromQueue();
+  // 注册一路视频，返回stream id；weight越大分到的推理机会越多
+  // reorder_timeout是按顺序输出时等待缺失帧的时间，为0时一直等待
+  // render为false时只输出检测结果：不绘制，原图在预处理之后立即释放
+  int AddStream(int width, int height, bool is_track = false,
+                int framerate = 30, int weight = 1, int max_pending = 0,
+                std::chrono::milliseconds reorder_timeout =
+                    std::chrono::milliseconds(500),
+                bool render = true);
+  void AddInferenceTask(int stream_id, std::shared_ptr<cv::Mat> src);
+  // 使用调用者的编号（从0开始连续），结果按编号的顺序输出
+  void AddInferenceTask(int stream_id, std::shared_ptr<cv::Mat> src,
+                        uint64_t sequence);
+  // 直接提交采集缓冲区，解码在推理线程中完成，结果中的image是解码后的图像
+  void AddInferenceTask(int stream_id, std::shared_ptr<RawFrame> frame);
+  std::shared_ptr<InferenceResult> GetResultFromQueue(int stream_id);
+  StreamStats GetStreamStats(int stream_id);
   int GetTasksSize();
+  // 模型的batch大于1时，把不同来源的图片合并推理：
+  // 凑够max_batch张或者最早的图片等待超过max_wait就提交
+  void SetBatchPolicy(int max_batch, std::chrono::microseconds max_wait);
+  // 后处理在NMS之前只保留分数最高的top_k个候选，小于等于0时不限制
+  void SetPreNmsTopK(int top_k);
+  // 单路低延时使用：CPU核心比NPU上下文多时，用空闲的核心并行解码一帧的
+  // 各个分支，CPU核心不够时返回false。需要在提交任务之前调用
+  bool SetParallelPostProcess(bool enable);
+  // 每个上下文最多同时处理depth帧：一帧在CPU上后处理的时候，下一帧已经提交给
+  // NPU。推理线程增加到thread_num * depth个，并行解码的辅助线程相应减少，
+  // 需要在提交任务之前调用
+  bool SetPipelineDepth(int depth);
 
  private:
   int thread_num_{1};
+  int pipeline_depth_{1};
   std::string model_path_{"null"};
   std::string label_path_{"null"};
-  uint32_t id{0};
+  std::vector<rknn_core_mask> core_masks_;
   std::unique_ptr<ThreadPool> pool_;
-  std::queue<std::shared_ptr<cv::Mat>> image_results_;
+  // 后处理的辅助线程池，推理线程等待它完成，所以不能和pool_共用
+  std::unique_ptr<ThreadPool> decode_pool_;
+  std::unique_ptr<NpuScheduler> scheduler_;
   std::vector<std::shared_ptr<Yolov8>> models_;
-  std::mutex id_mutex_;
-  std::mutex image_results_mutex_;
+  StreamRegistry streams_;
+
+  void ScheduleTask();
+  void RunNextTasks(int max_count);
+  void RunTasks(std::vector<InferenceTask> tasks);
+  void BatchLoop();
+  int max_batch_{1};
+  std::chrono::microseconds max_batch_wait_{5000};
+  std::mutex pending_mutex_;
+  std::condition_variable pending_condition_;
+  std::thread batch_thread_;
+  bool stop_{false};
+  // 从开始加载模型到第一次推理完成的时间
+  std::chrono::steady_clock::time_point init_time_;
+  std::once_flag first_inference_flag_;
 };
@@ -0,0 +1,56 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "condition_variable"
+#include "functional"
+#include "memory"
+#include "mutex"
+#include "opencv2/opencv.hpp"
+#include "string"
+#include "thread"
+#include "vector"
+
+// 离线处理一个长视频：把文件按chunk_frames帧切成若干段，轮流分给
+// decoder_num个VideoCapture并行解码，每一帧带着它在文件中的序号提交
+// 定位使用CAP_PROP_POS_FRAMES，FFmpeg后端会从前一个关键帧开始解码到目标帧，
+// 段越长，定位的额外开销越小
+// 提交的帧不能超过已经按顺序消费的位置window帧，内存占用有上限
+class SegmentedVideo {
+ public:
+  using FrameCallback =
+      std::function<void(uint64_t index, std::shared_ptr<cv::Mat> frame)>;
+  SegmentedVideo(const std::string &filename, int decoder_num,
+                 int chunk_frames, int window);
+  ~SegmentedVideo();
+  // callback在解码线程中调用
+  void Start(FrameCallback callback);
+  // 第index帧的结果已经按顺序处理完
+  void Consume(uint64_t index);
+  // 所有解码线程都已经结束，frame_count是实际解码的帧数
+  bool IsFinished(uint64_t *frame_count);
+  int get_frame_width();
+  int get_frame_height();
+  double get_fps();
+
+ private:
+  void DecodeLoop(int decoder_id);
+
+  std::string filename_;
+  int decoder_num_;
+  uint64_t chunk_frames_;
+  uint64_t window_;
+  int width_{0};
+  int height_{0};
+  double fps_{0.0};
+  uint64_t frame_count_{0};  // 文件头里的帧数，只是估计值
+  FrameCallback callback_;
+  uint64_t consumed_{0};
+  uint64_t end_index_;  // 遇到文件尾（或者读取失败）的位置
+  int running_{0};
+  bool stop_{false};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<std::thread> threads_;
+};
@@ -0,0 +1,67 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "deque"
+#include "image_process.h"
+#include "inference_task.h"
+#include "memory"
+#include "mutex"
+#include "queue"
+#include "tracking_stage.h"
+#include "vector"
+
+// 多路视频的注册表：每一路有自己的letterbox参数、跟踪器、结果队列和统计
+// 取任务时按权重轮询，繁忙的视频流不会饿死其他视频流
+class StreamRegistry {
+ public:
+  // max_pending为0表示不限制排队长度，否则超出时丢弃最早的帧
+  // reorder_timeout为0表示一直等待缺失的帧，不会跳过
+  // render为false时不绘制结果，只输出原图坐标的检测结果
+  int AddStream(int width, int height, int target_size, bool is_track,
+                int framerate, int weight, int max_pending,
+                std::chrono::milliseconds reorder_timeout, bool render);
+  int get_stream_count();
+  ImageProcess *get_image_process(int stream_id);
+  // image和raw_frame二选一，raw_frame在推理线程里解码
+  // sequence小于0时按提交的顺序编号，否则使用调用者的编号（从0开始连续，
+  // 例如多个解码线程并行提交同一个文件的帧），同一路视频不能混用
+  bool Push(int stream_id, std::shared_ptr<cv::Mat> image,
+            std::shared_ptr<RawFrame> raw_frame = nullptr,
+            int64_t sequence = -1);
+  // 按平滑加权轮询取出最多max_count个任务
+  int Pop(int max_count, std::vector<InferenceTask> *tasks);
+  int PendingSize();
+  bool GetOldestEnqueueTime(std::chrono::steady_clock::time_point *time);
+  // 工作线程乱序提交，经过TrackingStage按顺序进入结果队列
+  void PushResult(std::shared_ptr<InferenceResult> result);
+  // 这一帧没有结果（例如解码失败），跟踪阶段不再等待它
+  void SkipResult(int stream_id, uint64_t sequence);
+  std::shared_ptr<InferenceResult> PopResult(int stream_id);
+  StreamStats GetStats(int stream_id);
+
+ private:
+  struct Stream {
+    std::unique_ptr<ImageProcess> image_process;
+    int weight{1};
+    int current_weight{0};
+    int max_pending{0};
+    bool render{true};
+    uint64_t next_sequence{0};
+    uint64_t dropped{0};
+    std::deque<InferenceTask> pending;
+    std::queue<std::shared_ptr<InferenceResult>> results;
+    std::mutex results_mutex;
+    StreamStats stats{0, 0, 0.0, 0.0};
+    std::chrono::steady_clock::time_point last_result_time;
+    // 最后声明，保证先于结果队列析构
+    std::unique_ptr<TrackingStage> tracking_stage;
+  };
+  Stream *GetStream(int stream_id);
+  void DeliverResult(Stream *stream, std::shared_ptr<InferenceResult> result);
+
+  std::vector<std::unique_ptr<Stream>> streams_;
+  int pending_size_{0};
+  std::mutex mutex_;
+};
@@ -0,0 +1,51 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "BYTETracker.h"
+#include "chrono"
+#include "condition_variable"
+#include "functional"
+#include "image_process.h"
+#include "inference_task.h"
+#include "map"
+#include "memory"
+#include "mutex"
+#include "thread"
+
+// 每一路视频一个顺序处理阶段：工作线程乱序提交结果，这里按照sequence的顺序
+// 更新跟踪器并输出，工作线程不会因为跟踪器而阻塞
+// 被丢弃（或者超时未到达）的帧按没有检测结果更新跟踪器，保证时间轴连续：
+// 所有轨迹做一次卡尔曼预测，同时记为一次未匹配，连续丢失超过track_buffer帧的
+// 轨迹会被删除。BYTETracker没有只做预测的接口
+class TrackingStage {
+ public:
+  using OutputCallback = std::function<void(std::shared_ptr<InferenceResult>)>;
+  // reorder_timeout为0时一直等待缺失的帧，用于离线处理
+  TrackingStage(const ImageProcess *image_process, bool is_track, int framerate,
+                OutputCallback output,
+                std::chrono::milliseconds reorder_timeout =
+                    std::chrono::milliseconds(500));
+  ~TrackingStage();
+  void Push(std::shared_ptr<InferenceResult> result);
+  // 这一帧不会再有结果，例如排队过长被丢弃
+  void Skip(uint64_t sequence);
+
+ private:
+  void Loop();
+  void Process(std::shared_ptr<InferenceResult> result);
+
+  const ImageProcess *image_process_;
+  bool is_track_;
+  OutputCallback output_;
+  std::chrono::milliseconds reorder_timeout_;
+  std::unique_ptr<BYTETracker> tracker_;
+  // 等待按顺序处理的结果，nullptr表示这一帧被跳过
+  std::map<uint64_t, std::shared_ptr<InferenceResult>> reorder_;
+  uint64_t next_sequence_{0};
+  bool stop_{false};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread thread_;
+};
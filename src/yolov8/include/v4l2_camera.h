@@ -0,0 +1,53 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "atomic"
+#include "condition_variable"
+#include "memory"
+#include "mutex"
+#include "opencv2/opencv.hpp"
+#include "raw_frame.h"
+#include "string"
+#include "thread"
+#include "vector"
+
+// 直接使用V4L2的mmap缓冲区采集，采集线程独立运行，出队时打时间戳
+// 帧不做拷贝，直接交给推理池，解码在推理线程中完成
+// device是普通文件时进入模拟模式：MJPEG按照SOI/EOI切分，YUYV/NV12按照帧大小
+// 切分，按帧率循环播放，方便在没有摄像头的环境下测试
+class V4l2Camera {
+ public:
+  V4l2Camera(const std::string &device, cv::Size size, double framerate,
+             uint32_t fourcc, int buffer_count = 4);
+  ~V4l2Camera();
+  // 阻塞直到有新的帧，只保留最新的一帧，来不及取走的旧帧直接归还
+  std::shared_ptr<RawFrame> GetNextFrame(
+      std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+  cv::Size get_size();
+  uint64_t get_dropped();
+
+ private:
+  // 缓冲区的生命周期可能超过V4l2Camera，由帧的deleter共同持有
+  struct Device;
+  void CaptureLoop();
+  bool OpenDevice(const std::string &device, double framerate, uint32_t fourcc,
+                  int buffer_count);
+  bool OpenFakeDevice(const std::string &device, uint32_t fourcc,
+                      int buffer_count);
+  std::shared_ptr<RawFrame> Dequeue();
+  std::shared_ptr<RawFrame> DequeueFake();
+
+  std::shared_ptr<Device> device_;
+  cv::Size size_;
+  std::chrono::microseconds frame_interval_;
+  std::chrono::steady_clock::time_point next_fake_time_;
+  uint64_t sequence_{0};
+  uint64_t dropped_{0};
+  std::shared_ptr<RawFrame> latest_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
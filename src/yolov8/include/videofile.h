@@ -3,19 +3,34 @@
 //
 
 #pragma once
+#include "chrono"
+#include "memory"
 #include "opencv2/opencv.hpp"
 #include "string"
+#include "thread"
 class VideoFile {
  public:
-  VideoFile(const std::string&& filename);
+  // ring_size是预先分配的帧数，也是最多能提前解码的帧数
+  VideoFile(const std::string&& filename, int ring_size = 16);
   ~VideoFile();
   void Display(const float framerate = 25.0, const int target_size = 640);
-  std::unique_ptr<cv::Mat> GetNextFrame();
+  // 第一次调用时启动后台解码线程，之后从环形缓冲区取已经解码的帧
+  // 没有就绪的帧时最多等待timeout，返回nullptr；帧释放之后回到环形缓冲区
+  std::shared_ptr<cv::Mat> GetNextFrame(
+      std::chrono::milliseconds timeout = std::chrono::milliseconds(10));
+  // 文件已经读完，并且解码的帧都已经取走
+  bool IsEnd();
   cv::Mat test();
   int get_frame_width();
   int get_frame_height();
 
  private:
+  // 帧的生命周期可能超过VideoFile，由帧的deleter共同持有
+  struct FrameRing;
+  void DecodeLoop();
+
   std::string filename_;
   cv::VideoCapture* capture_{nullptr};
+  std::shared_ptr<FrameRing> ring_;
+  std::thread decode_thread_;
 };
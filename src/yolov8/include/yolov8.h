@@ -3,11 +3,19 @@
 //
 
 #pragma once
+#include "chrono"
 #include "common.h"
+#include "condition_variable"
+#include "model_file.h"
 #include "memory"
 #include "mutex"
 #include "rknn_api.h"
 #include "string"
+#include "vector"
+
+bool parse_core_mask(const std::string &str, rknn_core_mask *core_mask);
+bool parse_core_masks(const std::string &str,
+                      std::vector<rknn_core_mask> *core_masks);
 
 class Yolov8 {
  public:
@@ -15,18 +23,67 @@ class Yolov8 {
   ~Yolov8();
   int Inference(void *image_buf, object_detect_result_list *od_results,
                 letterbox_t letter_box);
+  // 批量推理，前count张图片已经写入get_input_buffer(0 ~ count-1, slot)
+  // od_results和letter_boxes都需要count个元素
+  int InferenceBatch(int count, object_detect_result_list *od_results,
+                     const letterbox_t *letter_boxes, int slot = 0);
+  uint8_t *get_input_buffer(int index, int slot = 0);
+  int get_batch_size();
   rknn_context *get_rknn_context();
-  int Init(rknn_context *ctx_in, bool copy_weight);
+  // copy_weight为true时从ctx_in复制上下文，不读取模型文件；
+  // 否则用model_file（为空时自己映射model_path）调用rknn_init
+  int Init(rknn_context *ctx_in, bool copy_weight, rknn_core_mask core_mask,
+           const ModelFile *model_file = nullptr);
   int DeInit();
   int get_model_width();
   int get_model_height();
+  // slot最近一次rknn_run的耗时
+  std::chrono::microseconds get_last_run_time(int slot = 0);
+  // 流水线的级数，每一级有独立的输入输出缓冲区。大于1时多个线程可以同时使用
+  // 这个上下文：一帧在CPU上后处理的时候，下一帧已经在NPU上运行。
+  // 需要在没有推理任务的时候调用，分配内存失败时返回false
+  bool SetPipelineDepth(int depth);
+  int get_pipeline_depth();
+  // 阻塞直到有空闲的一级，使用完之后调用ReleaseSlot归还
+  int AcquireSlot();
+  void ReleaseSlot(int slot);
+  // NMS之前最多保留的候选数量，小于等于0时不限制
+  void set_pre_nms_top_k(int top_k);
+  // 后处理使用的辅助线程池，为空时在推理线程中解码
+  void set_decode_pool(ThreadPool *pool);
 
  private:
-  rknn_app_context_t app_ctx_;
+  // 流水线的一级，NPU写这一级的输出时，CPU可以解码另一级的输出
+  struct PipelineSlot {
+    std::unique_ptr<uint8_t[]> input_buffer;
+    std::unique_ptr<rknn_output[]> outputs;
+    // 原生布局时NPU直接写入output_mems，否则rknn_outputs_get复制到
+    // output_buffers
+    std::vector<rknn_tensor_mem *> output_mems;
+    std::vector<std::unique_ptr<uint8_t[]>> output_buffers;
+    std::chrono::microseconds last_run_time{0};
+    bool busy{false};
+  };
+  int Run(void *input_buf, int count, object_detect_result_list *od_results,
+          const letterbox_t *letter_boxes, int slot);
+  void PostProcess(rknn_output *outputs, letterbox_t letter_box,
+                   object_detect_result_list *od_results);
+  void UseNchwOutputs();
+  bool SetupNativeOutputs();
+  bool AllocateSlot(PipelineSlot *slot);
+  void ReleaseSlots();
+  rknn_app_context_t app_ctx_{};
   rknn_context ctx_{0};
   std::string model_path_;
   std::unique_ptr<rknn_input[]> inputs_;
-  std::unique_ptr<rknn_output[]> outputs_;
-  std::mutex outputs_lock_;
+  // 输出的原生属性，不为空时输出是NPU的原生布局，不调用rknn_outputs_get
+  std::vector<rknn_tensor_attr> native_attrs_;
+  std::vector<PipelineSlot> slots_;
+  int bound_slot_{-1};  // 当前绑定到输出的是哪一级的内存
+  int batch_size_{1};
+  // 同一个上下文一次只提交一帧：从设置输入到取回输出
+  std::mutex run_lock_;
+  std::mutex slots_lock_;
+  std::condition_variable slots_condition_;
   ModelType model_type_;
 };
@@ -0,0 +1,105 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "cstdio"
+#include "fstream"
+#include "memory"
+#include "postprocess.h"
+#include "random"
+#include "rknn_stub.h"
+#include "string"
+#include "vector"
+#include "yolov8.h"
+
+// 主机测试共用的检查和模型构造，失败时打印位置，main返回失败的数量
+static int g_failures = 0;
+
+#define EXPECT_TRUE(condition)                                     \
+  do {                                                             \
+    if (!(condition)) {                                            \
+      fprintf(stderr, "%s:%d: expect %s\n", __FILE__, __LINE__,    \
+              #condition);                                         \
+      ++g_failures;                                                \
+    }                                                              \
+  } while (0)
+
+inline int finish_test(const char *name) {
+  if (g_failures == 0) {
+    printf("%s passed\n", name);
+  } else {
+    printf("%s: %d checks failed\n", name, g_failures);
+  }
+  return g_failures;
+}
+
+inline void init_test_labels() {
+  std::string label_path = YOLOV8_LABEL_PATH;
+  init_post_process(label_path);
+}
+
+// 量化的YOLOv8检测模型：三个分支各有64通道的DFL框和80个类别的分数，
+// objects_per_set[k]是第k组输出中每个分支有目标的网格数，为0时没有候选
+inline StubModel make_detection_model(int input_size,
+                                      const std::vector<int> &objects_per_set,
+                                      uint32_t seed = 1) {
+  StubModel model;
+  model.input_attr = stub_input_attr(input_size, input_size);
+  const int strides[3] = {8, 16, 32};
+  for (int b = 0; b < 3; ++b) {
+    int grid = input_size / strides[b];
+    model.output_attrs.push_back(stub_tensor_attr(
+        b * 2, 64, grid, grid, RKNN_TENSOR_INT8, -128, 0.1f));
+    model.output_attrs.push_back(stub_tensor_attr(
+        b * 2 + 1, OBJ_CLASS_NUM, grid, grid, RKNN_TENSOR_INT8, -128,
+        1.0f / 255));
+  }
+  std::mt19937 rng(seed);
+  for (int objects : objects_per_set) {
+    std::vector<std::vector<uint8_t>> outputs;
+    for (const auto &attr : model.output_attrs) {
+      std::vector<uint8_t> data(attr.n_elems);
+      int plane = attr.dims[2] * attr.dims[3];
+      bool is_score = attr.dims[1] == OBJ_CLASS_NUM;
+      for (auto &value : data) {
+        // 分数默认低于阈值（int8的-128 ~ -89），框的分布随机
+        value = is_score ? static_cast<uint8_t>(128 + rng() % 40)
+                         : static_cast<uint8_t>(rng() % 256);
+      }
+      for (int n = 0; is_score && n < objects; ++n) {
+        int cell = rng() % plane;
+        int cls = rng() % OBJ_CLASS_NUM;
+        data[cls * plane + cell] = static_cast<uint8_t>(rng() % 120);
+      }
+      outputs.push_back(std::move(data));
+    }
+    model.output_sets.push_back(std::move(outputs));
+  }
+  return model;
+}
+
+// 和RknnPool一样：第一个上下文读取模型文件，其余从它复制
+inline std::vector<std::unique_ptr<Yolov8>> create_models(
+    const std::vector<rknn_core_mask> &core_masks) {
+  std::string model_path = "rknn_stub_model.rknn";
+  std::ofstream(model_path) << "stub";
+  std::vector<std::unique_ptr<Yolov8>> models;
+  for (size_t i = 0; i < core_masks.size(); ++i) {
+    models.push_back(std::make_unique<Yolov8>(std::string(model_path)));
+    int ret = i == 0 ? models[0]->Init(nullptr, false, core_masks[0])
+                     : models[i]->Init(models[0]->get_rknn_context(), true,
+                                       core_masks[i]);
+    if (ret != 0) {
+      fprintf(stderr, "init stub context %zu failed\n", i);
+      models.clear();
+      break;
+    }
+  }
+  return models;
+}
+
+// 把帧号写入输入的前4个字节，模拟的运行时按它选择输出
+inline void write_frame_id(uint8_t *input, int frame_id) {
+  memcpy(input, &frame_id, sizeof(frame_id));
+}
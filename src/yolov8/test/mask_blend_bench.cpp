@@ -0,0 +1,81 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "chrono"
+#include "cstdio"
+#include "mask_blend.h"
+#include "postprocess.h"
+#include "random"
+#include "vector"
+
+// 分割掩码的混合：原来逐像素的浮点混合，对比blend_mask_row
+// 掩码覆盖整帧（最坏情况）和一半的像素，输出每帧的耗时
+// 用法：mask_blend_bench [iterations]
+static const uint8_t kColor[3] = {56, 56, 255};
+
+// 原来ProcessSegmentImage里的混合，alpha = 0.5
+static void blend_float(uint8_t *image, const uint8_t *mask, int pixels) {
+  const float alpha = 0.5f;
+  uint8_t *pixel = image;
+  for (int x = 0; x < pixels; ++x, pixel += 3) {
+    if (mask[x] == 0) {
+      continue;
+    }
+    for (int c = 0; c < 3; ++c) {
+      pixel[c] = (unsigned char)clamp(
+          kColor[c] * (1 - alpha) + pixel[c] * alpha, 0, 255);
+    }
+  }
+}
+
+template <typename Func>
+static double average_ms(int iterations, Func func) {
+  func();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    func();
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         iterations;
+}
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 20;
+  const int sizes[3][2] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+  uint16_t bias[3];
+  mask_color_bias(kColor, bias);
+  std::mt19937 rng(1);
+  printf("%12s %8s %12s %12s\n", "size", "mask", "float(ms)", "simd(ms)");
+  for (const auto &size : sizes) {
+    int width = size[0];
+    int height = size[1];
+    std::vector<uint8_t> image(width * height * 3);
+    for (auto &value : image) {
+      value = rng() % 256;
+    }
+    for (int coverage : {100, 50}) {
+      std::vector<uint8_t> mask(width * height);
+      for (auto &value : mask) {
+        value = static_cast<int>(rng() % 100) < coverage ? 1 : 0;
+      }
+      double float_ms = average_ms(iterations, [&] {
+        for (int y = 0; y < height; ++y) {
+          blend_float(image.data() + y * width * 3, mask.data() + y * width,
+                      width);
+        }
+      });
+      double simd_ms = average_ms(iterations, [&] {
+        for (int y = 0; y < height; ++y) {
+          blend_mask_row(image.data() + y * width * 3,
+                         mask.data() + y * width, width, bias);
+        }
+      });
+      printf("%5dx%-6d %7d%% %12.2f %12.2f\n", width, height, coverage,
+             float_ms, simd_ms);
+    }
+  }
+  return 0;
+}
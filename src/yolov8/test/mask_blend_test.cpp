@@ -0,0 +1,57 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "host_test.h"
+#include "mask_blend.h"
+
+// blend_mask_row的NEON/SSSE3路径和标量路径逐字节比较：
+// 不同的长度（包括不足16个像素的尾部）、全0和部分为0的掩码块、所有的类别颜色
+static const char *simd_name() {
+#if defined(__ARM_NEON)
+  return "NEON";
+#elif defined(__SSSE3__)
+  return "SSSE3";
+#else
+  return "none";
+#endif
+}
+
+int main() {
+  std::mt19937 rng(5);
+  int rows = 0;
+  int mismatches = 0;
+  for (int count : {0, 1, 15, 16, 17, 31, 32, 47, 100, 640, 1921}) {
+    for (int density : {0, 1, 2, 4}) {
+      std::vector<uint8_t> mask(count);
+      for (int x = 0; x < count; ++x) {
+        // density为0时全部为0，为1时只有部分16像素的块里有掩码
+        bool on = density == 1 ? (x / 16) % 3 == 1 && rng() % 2
+                               : density > 0 && rng() % density == 0;
+        mask[x] = on ? static_cast<uint8_t>(1 + rng() % 255) : 0;
+      }
+      for (int color = 0; color < 256; color += 15) {
+        const uint8_t bgr[3] = {static_cast<uint8_t>(color),
+                                static_cast<uint8_t>(255 - color),
+                                static_cast<uint8_t>(rng() % 256)};
+        uint16_t bias[3];
+        mask_color_bias(bgr, bias);
+        std::vector<uint8_t> pixels(count * 3);
+        for (auto &value : pixels) {
+          value = rng() % 256;
+        }
+        std::vector<uint8_t> expected = pixels;
+        blend_mask_row_scalar(expected.data(), mask.data(), count, bias);
+        blend_mask_row(pixels.data(), mask.data(), count, bias);
+        rows++;
+        if (pixels != expected) {
+          mismatches++;
+        }
+      }
+    }
+  }
+  printf("simd path %s: %d rows, %d differ from the scalar path\n",
+         simd_name(), rows, mismatches);
+  EXPECT_TRUE(mismatches == 0);
+  return finish_test("mask_blend_test");
+}
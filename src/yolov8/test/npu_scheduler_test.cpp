@@ -0,0 +1,109 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "atomic"
+#include "host_test.h"
+#include "npu_scheduler.h"
+#include "thread"
+
+// 先让每个上下文跑一次，记录各自的耗时
+static void seed_run_times(NpuScheduler *scheduler,
+                           const std::vector<int> &run_times_us) {
+  std::vector<int> ids;
+  for (size_t i = 0; i < run_times_us.size(); ++i) {
+    ids.push_back(scheduler->Acquire());
+  }
+  for (size_t i = 0; i < ids.size(); ++i) {
+    scheduler->Release(ids[i], std::chrono::microseconds(run_times_us[i]));
+  }
+}
+
+static void test_select_context() {
+  // 每个上下文只有一帧在途时，只在空闲的上下文中选择最快的
+  NpuScheduler single(3, 1);
+  seed_run_times(&single, {2000, 4000, 8000});
+  int first = single.Acquire();
+  int second = single.Acquire();
+  int third = single.Acquire();
+  EXPECT_TRUE(first == 0);
+  EXPECT_TRUE(second == 1);
+  EXPECT_TRUE(third == 2);
+
+  // 允许两帧在途时，预计完成时间包括排在前面的一帧：
+  // 已经有一帧的快核心（2 * 2ms）比空闲的慢核心（8ms）更早完成
+  NpuScheduler pipelined(3, 2);
+  seed_run_times(&pipelined, {2000, 4000, 8000});
+  std::vector<int> order;
+  for (int i = 0; i < 3; ++i) {
+    order.push_back(pipelined.Acquire());
+  }
+  EXPECT_TRUE(order[0] == 0);
+  EXPECT_TRUE(order[1] == 1);
+  EXPECT_TRUE(order[2] == 0);
+  EXPECT_TRUE(pipelined.get_in_flight(2) == 0);
+}
+
+// 每个NPU核心的耗时不同，分到的帧数应该和速度一致
+static std::vector<int> run_on_stub(int depth, int frames) {
+  const std::vector<rknn_core_mask> core_masks = {
+      RKNN_NPU_CORE_0, RKNN_NPU_CORE_1, RKNN_NPU_CORE_2};
+  auto models = create_models(core_masks);
+  EXPECT_TRUE(models.size() == core_masks.size());
+  for (auto &model : models) {
+    EXPECT_TRUE(model->SetPipelineDepth(depth));
+  }
+  NpuScheduler scheduler(models.size(), depth);
+  std::vector<std::atomic<int>> counts(models.size());
+  std::atomic<int> next{0};
+  std::vector<std::thread> workers;
+  for (size_t w = 0; w < models.size() * depth; ++w) {
+    workers.emplace_back([&] {
+      for (int frame = next++; frame < frames; frame = next++) {
+        int id = scheduler.Acquire();
+        auto &model = models[id];
+        int slot = model->AcquireSlot();
+        write_frame_id(model->get_input_buffer(0, slot), frame);
+        object_detect_result_list od_results;
+        letterbox_t letter_box = {0, 0, 1.0f};
+        model->InferenceBatch(1, &od_results, &letter_box, slot);
+        auto run_time = model->get_last_run_time(slot);
+        model->ReleaseSlot(slot);
+        scheduler.Release(id, run_time);
+        counts[id]++;
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  std::vector<int> result;
+  for (size_t i = 0; i < models.size(); ++i) {
+    result.push_back(counts[i]);
+    // 同一个上下文不会同时执行两次rknn_run
+    EXPECT_TRUE(
+        rknn_stub_get_stats(*models[i]->get_rknn_context())
+            .max_concurrent_runs == 1);
+  }
+  printf("depth %d: core0(2ms) %d, core1(4ms) %d, core2(8ms) %d frames\n",
+         depth, result[0], result[1], result[2]);
+  return result;
+}
+
+int main() {
+  init_test_labels();
+  test_select_context();
+
+  rknn_stub_set_model(make_detection_model(64, {0}));
+  rknn_stub_set_latency(RKNN_NPU_CORE_0, std::chrono::milliseconds(2));
+  rknn_stub_set_latency(RKNN_NPU_CORE_1, std::chrono::milliseconds(4));
+  rknn_stub_set_latency(RKNN_NPU_CORE_2, std::chrono::milliseconds(8));
+  for (int depth = 1; depth <= 2; ++depth) {
+    auto counts = run_on_stub(depth, 210);
+    EXPECT_TRUE(counts[0] + counts[1] + counts[2] == 210);
+    EXPECT_TRUE(counts[0] > counts[1]);
+    EXPECT_TRUE(counts[1] > counts[2]);
+  }
+  deinit_post_process();
+  return finish_test("npu_scheduler_test");
+}
@@ -0,0 +1,228 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "Float16.h"
+#include "host_test.h"
+
+// 同一组输出按NCHW、NC1HWC2和NHWC三种布局排列，后处理的结果应该完全相同
+// 覆盖检测（分数的候选收集和DFL）、v10检测（按类别平面扫描）和分割（原型按
+// 布局只读取检测框内的单元），每种都有int8、fp16和fp32的输出
+enum class Layout { NCHW, NC1HWC2, NHWC };
+enum class DataType { INT8, FP16, FP32 };
+
+static const char *layout_name(Layout layout) {
+  switch (layout) {
+    case Layout::NCHW:
+      return "NCHW";
+    case Layout::NC1HWC2:
+      return "NC1HWC2";
+    default:
+      return "NHWC";
+  }
+}
+
+static const char *type_name(DataType type) {
+  switch (type) {
+    case DataType::INT8:
+      return "int8";
+    case DataType::FP16:
+      return "fp16";
+    default:
+      return "fp32";
+  }
+}
+
+// NCHW的int8输出，其他类型由它反量化得到
+struct SyntheticModel {
+  std::vector<rknn_tensor_attr> attrs;
+  std::vector<std::vector<int8_t>> tensors;
+};
+
+// 每个分支依次是box、score、score sum，分割模型再加上分割系数，最后是proto
+static SyntheticModel make_model(bool segment, uint32_t seed) {
+  SyntheticModel model;
+  std::mt19937 rng(seed);
+  const int grids[3] = {80, 40, 20};
+  for (int b = 0; b < 3; ++b) {
+    int plane = grids[b] * grids[b];
+    std::vector<int> channels = {64, OBJ_CLASS_NUM, 1};
+    if (segment) {
+      channels.push_back(PROTO_CHANNEL);
+    }
+    for (size_t k = 0; k < channels.size(); ++k) {
+      float scale = k == 0 ? 0.1f : (k == 3 ? 0.05f : 1.0f / 255);
+      int32_t zp = k == 3 ? 5 : -128;
+      model.attrs.push_back(stub_tensor_attr(model.attrs.size(), channels[k],
+                                             grids[b], grids[b],
+                                             RKNN_TENSOR_INT8, zp, scale));
+      std::vector<int8_t> tensor(channels[k] * plane);
+      for (auto &value : tensor) {
+        // 分数低于阈值，score sum取最大值不做过滤，框和系数随机
+        value = k == 1   ? static_cast<int8_t>(-128 + rng() % 40)
+                : k == 2 ? 127
+                         : static_cast<int8_t>(rng() % 256 - 128);
+      }
+      if (k == 1) {
+        for (int n = 0; n < plane / 200 + 2; ++n) {
+          int cell = rng() % plane;
+          int cls = rng() % OBJ_CLASS_NUM;
+          tensor[cls * plane + cell] = static_cast<int8_t>(rng() % 120);
+        }
+      }
+      model.tensors.push_back(std::move(tensor));
+    }
+  }
+  if (segment) {
+    model.attrs.push_back(stub_tensor_attr(model.attrs.size(), PROTO_CHANNEL,
+                                           PROTO_HEIGHT, PROTO_WEIGHT,
+                                           RKNN_TENSOR_INT8, -7, 0.02f));
+    std::vector<int8_t> proto(PROTO_CHANNEL * PROTO_HEIGHT * PROTO_WEIGHT);
+    for (auto &value : proto) {
+      value = static_cast<int8_t>(rng() % 256 - 128);
+    }
+    model.tensors.push_back(std::move(proto));
+  }
+  return model;
+}
+
+static int get_c2(Layout layout, DataType type, int channel) {
+  if (layout == Layout::NCHW) {
+    return 1;
+  }
+  if (layout == Layout::NHWC) {
+    return channel;
+  }
+  return type == DataType::INT8 ? 16 : (type == DataType::FP16 ? 8 : 4);
+}
+
+// 按common.h中tensor_layout_t的定义排列，NC1HWC2最后一块不足c2的通道补0
+template <typename T>
+static std::vector<uint8_t> arrange(const std::vector<T> &nchw, int channel,
+                                    const tensor_layout_t &layout) {
+  int c1_num = (channel + layout.c2 - 1) / layout.c2;
+  std::vector<T> tensor(c1_num * layout.plane * layout.c2, 0);
+  for (int c = 0; c < channel; ++c) {
+    for (int cell = 0; cell < layout.plane; ++cell) {
+      int offset = (c / layout.c2) * layout.plane * layout.c2 +
+                   cell * layout.c2 + c % layout.c2;
+      tensor[offset] = nchw[c * layout.plane + cell];
+    }
+  }
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(tensor.data());
+  return std::vector<uint8_t>(bytes, bytes + tensor.size() * sizeof(T));
+}
+
+enum class Task { DETECTION, V10_DETECTION, SEGMENT };
+
+static void run(const SyntheticModel &model, Task task, Layout layout,
+                DataType type, object_detect_result_list *od_results) {
+  size_t n_output = model.attrs.size();
+  std::vector<rknn_tensor_attr> attrs = model.attrs;
+  std::vector<tensor_layout_t> layouts(n_output);
+  std::vector<std::vector<uint8_t>> buffers(n_output);
+  std::vector<rknn_output> outputs(n_output);
+  for (size_t i = 0; i < n_output; ++i) {
+    int channel = attrs[i].dims[1];
+    layouts[i] = {static_cast<int>(attrs[i].dims[2] * attrs[i].dims[3]),
+                  get_c2(layout, type, channel)};
+    const auto &tensor = model.tensors[i];
+    if (type == DataType::INT8) {
+      buffers[i] = arrange(tensor, channel, layouts[i]);
+    } else {
+      std::vector<float> values(tensor.size());
+      for (size_t j = 0; j < tensor.size(); ++j) {
+        values[j] = (tensor[j] - attrs[i].zp) * attrs[i].scale;
+      }
+      if (type == DataType::FP16) {
+        std::vector<uint16_t> halves(values.size());
+        rknpu2::to_fp16(values.data(), halves.data(), values.size());
+        buffers[i] = arrange(halves, channel, layouts[i]);
+      } else {
+        buffers[i] = arrange(values, channel, layouts[i]);
+      }
+    }
+    memset(&outputs[i], 0, sizeof(rknn_output));
+    outputs[i].index = i;
+    outputs[i].buf = buffers[i].data();
+    outputs[i].size = buffers[i].size();
+  }
+  rknn_app_context_t app_ctx;
+  memset(&app_ctx, 0, sizeof(app_ctx));
+  app_ctx.io_num.n_output = n_output;
+  app_ctx.output_attrs = attrs.data();
+  app_ctx.output_layouts = layouts.data();
+  app_ctx.model_width = 640;
+  app_ctx.model_height = 640;
+  app_ctx.is_quant = type == DataType::INT8;
+  app_ctx.is_fp16 = type == DataType::FP16;
+  app_ctx.pre_nms_top_k = PRE_NMS_TOP_K;
+  letterbox_t letter_box = {0, 80, 0.5f};
+  memset(od_results, 0, sizeof(object_detect_result_list));
+  if (task == Task::DETECTION) {
+    post_process(&app_ctx, outputs.data(), &letter_box, BOX_THRESH,
+                 NMS_THRESH, od_results);
+  } else if (task == Task::V10_DETECTION) {
+    post_process_v10_detection(&app_ctx, outputs.data(), &letter_box,
+                               BOX_THRESH, od_results);
+  } else {
+    post_process_seg(&app_ctx, outputs.data(), &letter_box, BOX_THRESH,
+                     NMS_THRESH, od_results);
+  }
+}
+
+static bool same_results(const object_detect_result_list &a,
+                         const object_detect_result_list &b) {
+  if (a.count != b.count) {
+    return false;
+  }
+  for (int i = 0; i < a.count; ++i) {
+    if (memcmp(&a.results[i], &b.results[i], sizeof(object_detect_result)) !=
+        0) {
+      return false;
+    }
+    const auto &seg_a = a.results_seg[i];
+    const auto &seg_b = b.results_seg[i];
+    if (seg_a.width != seg_b.width || seg_a.height != seg_b.height ||
+        (seg_a.seg_mask == nullptr) != (seg_b.seg_mask == nullptr)) {
+      return false;
+    }
+    if (seg_a.seg_mask != nullptr &&
+        memcmp(seg_a.seg_mask, seg_b.seg_mask, seg_a.width * seg_a.height) !=
+            0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  init_test_labels();
+  const SyntheticModel detection_model = make_model(false, 7);
+  const SyntheticModel segment_model = make_model(true, 11);
+  const Task tasks[3] = {Task::DETECTION, Task::V10_DETECTION, Task::SEGMENT};
+  const char *task_names[3] = {"v8", "v10", "seg"};
+  // 结果里有分割的掩码，放在堆上
+  auto reference = std::make_unique<object_detect_result_list>();
+  auto result = std::make_unique<object_detect_result_list>();
+  for (int t = 0; t < 3; ++t) {
+    const auto &model =
+        tasks[t] == Task::SEGMENT ? segment_model : detection_model;
+    for (DataType type : {DataType::INT8, DataType::FP16, DataType::FP32}) {
+      run(model, tasks[t], Layout::NCHW, type, reference.get());
+      EXPECT_TRUE(reference->count > 0);
+      for (Layout layout : {Layout::NC1HWC2, Layout::NHWC}) {
+        run(model, tasks[t], layout, type, result.get());
+        bool same = same_results(*reference, *result);
+        printf("%s %s %s vs NCHW: %d results, %s\n", task_names[t],
+               type_name(type), layout_name(layout), result->count,
+               same ? "identical" : "different");
+        EXPECT_TRUE(same);
+        release_seg_masks(result.get());
+      }
+      release_seg_masks(reference.get());
+    }
+  }
+  deinit_post_process();
+  return finish_test("output_layout_test");
+}
@@ -0,0 +1,115 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "atomic"
+#include "host_test.h"
+#include "npu_scheduler.h"
+#include "thread"
+
+// 一个上下文的流水线：depth个推理线程共用一个上下文，一帧在CPU上后处理的时候
+// 下一帧已经开始rknn_run。检查每一帧拿到的都是自己的结果、同一个上下文不会
+// 同时执行两次rknn_run，并输出depth为1和2时的帧率
+// 用法：pipeline_test [npu_us [frames]]，npu_us是模拟的每帧NPU耗时
+static const int kOutputSets = 2;
+
+static bool same_results(const object_detect_result_list &a,
+                         const object_detect_result_list &b) {
+  if (a.count != b.count) {
+    return false;
+  }
+  for (int i = 0; i < a.count; ++i) {
+    if (memcmp(&a.results[i], &b.results[i], sizeof(object_detect_result)) !=
+        0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void infer(Yolov8 *model, int frame_id,
+                  object_detect_result_list *od_results,
+                  std::chrono::microseconds *run_time) {
+  int slot = model->AcquireSlot();
+  write_frame_id(model->get_input_buffer(0, slot), frame_id);
+  letterbox_t letter_box = {0, 0, 1.0f};
+  model->InferenceBatch(1, od_results, &letter_box, slot);
+  *run_time = model->get_last_run_time(slot);
+  model->ReleaseSlot(slot);
+}
+
+// 返回每秒的帧数
+static double run_pipeline(bool native, int depth, int frames) {
+  auto models = create_models({RKNN_NPU_CORE_0});
+  EXPECT_TRUE(models.size() == 1);
+  if (models.empty()) {
+    return 0.0;
+  }
+  Yolov8 *model = models[0].get();
+  EXPECT_TRUE(model->SetPipelineDepth(depth));
+  // 先逐帧得到每组输出的结果
+  std::vector<std::unique_ptr<object_detect_result_list>> expected;
+  for (int set = 0; set < kOutputSets; ++set) {
+    expected.push_back(std::make_unique<object_detect_result_list>());
+    std::chrono::microseconds run_time;
+    infer(model, set, expected.back().get(), &run_time);
+  }
+  EXPECT_TRUE(expected[0]->count != expected[1]->count);
+  rknn_stub_reset_stats();
+
+  NpuScheduler scheduler(1, depth);
+  std::atomic<int> next{0};
+  std::atomic<int> wrong{0};
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int w = 0; w < depth; ++w) {
+    workers.emplace_back([&] {
+      auto od_results = std::make_unique<object_detect_result_list>();
+      for (int frame = next++; frame < frames; frame = next++) {
+        int id = scheduler.Acquire();
+        std::chrono::microseconds run_time;
+        infer(model, frame, od_results.get(), &run_time);
+        scheduler.Release(id, run_time);
+        if (!same_results(*od_results, *expected[frame % kOutputSets])) {
+          wrong++;
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  auto stats = rknn_stub_get_stats(*model->get_rknn_context());
+  EXPECT_TRUE(wrong == 0);
+  EXPECT_TRUE(stats.runs == frames);
+  EXPECT_TRUE(stats.max_concurrent_runs == 1);
+  double fps = frames / seconds;
+  printf("%s depth %d: %.1f fps, npu busy %.0f%%, %d wrong results\n",
+         native ? "native" : "NCHW  ", depth, fps,
+         100.0 * stats.busy.count() / (seconds * 1e6), wrong.load());
+  return fps;
+}
+
+int main(int argc, char **argv) {
+  int npu_us = argc > 1 ? atoi(argv[1]) : 4000;
+  int frames = argc > 2 ? atoi(argv[2]) : 200;
+  init_test_labels();
+  rknn_stub_set_latency(RKNN_NPU_CORE_0, std::chrono::microseconds(npu_us));
+  // 两组输出的检测数量不同，结果错位时一定能发现
+  StubModel model = make_detection_model(640, {40, 3});
+  for (bool native : {false, true}) {
+    // native为true时输出绑定到每个slot自己的rknn_tensor_mem，
+    // 否则由rknn_outputs_get复制到预先分配的缓冲区
+    model.native_output_attrs =
+        native ? model.output_attrs : std::vector<rknn_tensor_attr>();
+    rknn_stub_set_model(model);
+    for (int depth = 1; depth <= 2; ++depth) {
+      run_pipeline(native, depth, frames);
+    }
+  }
+  deinit_post_process();
+  return finish_test("pipeline_test");
+}
@@ -0,0 +1,494 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "Float16.h"
+#include "algorithm"
+#include "cmath"
+#include "host_test.h"
+#include "opencv2/opencv.hpp"
+#include "threadpool.h"
+
+// 后处理和参考解码比较：参考解码把每个输出都还原成float，逐个网格单元解码所有
+// 候选的框，按分数排序之后截取前top_k个再做NMS，没有分阶段和并行
+// 覆盖NMS之前top_k的截断（候选多于pre_nms_top_k）、姿态模型（只为NMS之后的
+// 目标解码关键点）、旋转框模型和yolov10的有界堆，每种都有int8、fp16和fp32
+// 的输出，并且分别在推理线程和辅助线程池中解码
+enum class DataType { INT8, FP16, FP32 };
+enum class Task { DETECTION, V10_DETECTION, POSE, OBB };
+
+static const char *type_name(DataType type) {
+  switch (type) {
+    case DataType::INT8:
+      return "int8";
+    case DataType::FP16:
+      return "fp16";
+    default:
+      return "fp32";
+  }
+}
+
+// 超过阈值的候选数量，NMS之前只保留kTopK个
+static const int kCandidates = 100;
+static const int kTopK = 40;
+// yolov10的候选多于OBJ_NUMB_MAX_SIZE，每两个候选的分数相同
+static const int kV10Candidates = 200;
+static const int kV10Ties = 2;
+static const int kObbClassNum = 15;
+
+// 每个分支中一个输出的通道数和量化参数
+struct OutputSpec {
+  int channel;
+  int32_t zp;
+  float scale;
+};
+
+// NCHW的int8输出，其他类型由它反量化得到
+struct SyntheticModel {
+  std::vector<rknn_tensor_attr> attrs;
+  std::vector<std::vector<int8_t>> tensors;
+  int outputs_per_branch;
+  int class_num;
+};
+
+// 每个分支的第一个输出是DFL框，第二个是类别分数，之后是specs中的其他输出
+// 候选放在随机的网格单元，分数从高到低，每ties个候选的分数相同
+// ties为1时排序和NMS的结果是唯一的；截取的数量是ties的倍数时，
+// 保留下来的候选也是确定的
+static SyntheticModel make_model(int class_num,
+                                 const std::vector<OutputSpec> &specs,
+                                 int candidates, int ties, uint32_t seed) {
+  SyntheticModel model;
+  model.outputs_per_branch = specs.size() + 2;
+  model.class_num = class_num;
+  std::vector<OutputSpec> branch_specs = {{64, 0, 0.1f},
+                                          {class_num, -128, 1.0f / 255}};
+  branch_specs.insert(branch_specs.end(), specs.begin(), specs.end());
+  std::mt19937 rng(seed);
+  const int grids[3] = {80, 40, 20};
+  for (int b = 0; b < 3; ++b) {
+    int plane = grids[b] * grids[b];
+    for (size_t k = 0; k < branch_specs.size(); ++k) {
+      const OutputSpec &spec = branch_specs[k];
+      model.attrs.push_back(stub_tensor_attr(model.attrs.size(), spec.channel,
+                                             grids[b], grids[b],
+                                             RKNN_TENSOR_INT8, spec.zp,
+                                             spec.scale));
+      std::vector<int8_t> tensor(spec.channel * plane);
+      for (auto &value : tensor) {
+        // 分数低于阈值（-128 ~ -89），其他输出随机
+        value = k == 1 ? static_cast<int8_t>(-128 + rng() % 40)
+                       : static_cast<int8_t>(rng() % 256 - 128);
+      }
+      model.tensors.push_back(std::move(tensor));
+    }
+  }
+  // 超过阈值的分数是1 ~ 127，量化的阈值是0
+  std::vector<std::vector<bool>> used(3);
+  for (int b = 0; b < 3; ++b) {
+    used[b].resize(grids[b] * grids[b]);
+  }
+  for (int n = 0; n < candidates;) {
+    int b = rng() % 3;
+    int plane = grids[b] * grids[b];
+    int cell = rng() % plane;
+    if (used[b][cell]) {
+      continue;
+    }
+    used[b][cell] = true;
+    int cls = rng() % class_num;
+    int level = 127 - n / ties;
+    model.tensors[b * model.outputs_per_branch + 1][cls * plane + cell] =
+        static_cast<int8_t>(level);
+    ++n;
+  }
+  return model;
+}
+
+// 运行时输出的缓冲区，以及参考解码读取的数值（和缓冲区中的数值相同）
+struct ModelOutputs {
+  std::vector<std::vector<uint8_t>> buffers;
+  std::vector<std::vector<float>> values;
+};
+
+template <typename T>
+static std::vector<uint8_t> to_bytes(const std::vector<T> &tensor) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(tensor.data());
+  return std::vector<uint8_t>(bytes, bytes + tensor.size() * sizeof(T));
+}
+
+static ModelOutputs make_outputs(const SyntheticModel &model, DataType type) {
+  ModelOutputs data;
+  for (size_t i = 0; i < model.attrs.size(); ++i) {
+    const auto &tensor = model.tensors[i];
+    std::vector<float> values(tensor.size());
+    for (size_t j = 0; j < tensor.size(); ++j) {
+      values[j] = (tensor[j] - model.attrs[i].zp) * model.attrs[i].scale;
+    }
+    if (type == DataType::INT8) {
+      data.buffers.push_back(to_bytes(tensor));
+    } else if (type == DataType::FP16) {
+      std::vector<uint16_t> halves(values.size());
+      rknpu2::to_fp16(values.data(), halves.data(), values.size());
+      rknpu2::to_fp32(halves.data(), values.data(), values.size());
+      data.buffers.push_back(to_bytes(halves));
+    } else {
+      data.buffers.push_back(to_bytes(values));
+    }
+    data.values.push_back(std::move(values));
+  }
+  return data;
+}
+
+static const letterbox_t kLetterBox = {0, 80, 0.5f};
+
+static void run(const SyntheticModel &model, ModelOutputs &data, Task task,
+                DataType type, int top_k, ThreadPool *pool,
+                object_detect_result_list *od_results) {
+  size_t n_output = model.attrs.size();
+  std::vector<rknn_tensor_attr> attrs = model.attrs;
+  std::vector<tensor_layout_t> layouts(n_output);
+  std::vector<rknn_output> outputs(n_output);
+  for (size_t i = 0; i < n_output; ++i) {
+    layouts[i] = {static_cast<int>(attrs[i].dims[2] * attrs[i].dims[3]), 1};
+    memset(&outputs[i], 0, sizeof(rknn_output));
+    outputs[i].index = i;
+    outputs[i].buf = data.buffers[i].data();
+    outputs[i].size = data.buffers[i].size();
+  }
+  rknn_app_context_t app_ctx;
+  memset(&app_ctx, 0, sizeof(app_ctx));
+  app_ctx.io_num.n_output = n_output;
+  app_ctx.output_attrs = attrs.data();
+  app_ctx.output_layouts = layouts.data();
+  app_ctx.model_width = 640;
+  app_ctx.model_height = 640;
+  app_ctx.is_quant = type == DataType::INT8;
+  app_ctx.is_fp16 = type == DataType::FP16;
+  app_ctx.pre_nms_top_k = top_k;
+  app_ctx.decode_pool = pool;
+  letterbox_t letter_box = kLetterBox;
+  memset(od_results, 0, sizeof(object_detect_result_list));
+  switch (task) {
+    case Task::DETECTION:
+      post_process(&app_ctx, outputs.data(), &letter_box, BOX_THRESH,
+                   NMS_THRESH, od_results);
+      break;
+    case Task::V10_DETECTION:
+      post_process_v10_detection(&app_ctx, outputs.data(), &letter_box,
+                                 BOX_THRESH, od_results);
+      break;
+    case Task::POSE:
+      post_process_pose(&app_ctx, outputs.data(), &letter_box, BOX_THRESH,
+                        NMS_THRESH, od_results);
+      break;
+    case Task::OBB:
+      post_process_obb(&app_ctx, outputs.data(), &letter_box, BOX_THRESH,
+                       NMS_THRESH, od_results);
+      break;
+  }
+}
+
+// 参考解码的候选，box是模型输入上的x, y, w, h（旋转框是中心点）
+struct ReferenceCandidate {
+  float score;
+  int cls_id;
+  int branch;
+  int cell;
+  float box[4];
+  float theta;
+};
+
+static float value_at(const SyntheticModel &model, const ModelOutputs &data,
+                      int index, int cell, int channel) {
+  int plane = model.attrs[index].dims[2] * model.attrs[index].dims[3];
+  return data.values[index][channel * plane + cell];
+}
+
+// 到四条边的距离：每条边16个通道做softmax，取下标的期望
+static void reference_dfl(const SyntheticModel &model, const ModelOutputs &data,
+                          int box_idx, int cell, float *distance) {
+  for (int edge = 0; edge < 4; ++edge) {
+    float sum = 0, expectation = 0;
+    for (int i = 0; i < 16; ++i) {
+      float weight =
+          std::exp(value_at(model, data, box_idx, cell, edge * 16 + i));
+      sum += weight;
+      expectation += weight * i;
+    }
+    distance[edge] = expectation / sum;
+  }
+}
+
+static void reference_box(const SyntheticModel &model, const ModelOutputs &data,
+                          Task task, ReferenceCandidate *candidate) {
+  int box_idx = candidate->branch * model.outputs_per_branch;
+  int grid_w = model.attrs[box_idx].dims[3];
+  float stride = 640.0f / model.attrs[box_idx].dims[2];
+  float i = candidate->cell / grid_w + 0.5f;
+  float j = candidate->cell % grid_w + 0.5f;
+  float d[4];
+  reference_dfl(model, data, box_idx, candidate->cell, d);
+  if (task == Task::OBB) {
+    float theta = value_at(model, data, box_idx + 2, candidate->cell, 0);
+    float xf = (d[2] - d[0]) / 2.0f;
+    float yf = (d[3] - d[1]) / 2.0f;
+    candidate->box[0] = (xf * cos(theta) - yf * sin(theta) + j) * stride;
+    candidate->box[1] = (xf * sin(theta) + yf * cos(theta) + i) * stride;
+    candidate->box[2] = (d[0] + d[2]) * stride;
+    candidate->box[3] = (d[1] + d[3]) * stride;
+    candidate->theta = theta;
+    return;
+  }
+  candidate->box[0] = (j - d[0]) * stride;
+  candidate->box[1] = (i - d[1]) * stride;
+  candidate->box[2] = (d[0] + d[2]) * stride;
+  candidate->box[3] = (d[1] + d[3]) * stride;
+  candidate->theta = 0;
+}
+
+static float box_iou(const float *a, const float *b) {
+  float w = std::max(0.f, std::min(a[0] + a[2], b[0] + b[2]) -
+                              std::max(a[0], b[0]) + 1.0f);
+  float h = std::max(0.f, std::min(a[1] + a[3], b[1] + b[3]) -
+                              std::max(a[1], b[1]) + 1.0f);
+  float inter = w * h;
+  float uni = (a[2] + 1.0f) * (a[3] + 1.0f) + (b[2] + 1.0f) * (b[3] + 1.0f) -
+              inter;
+  return uni <= 0.f ? 0.f : inter / uni;
+}
+
+static float rotated_iou(const ReferenceCandidate &a,
+                         const ReferenceCandidate &b) {
+  cv::RotatedRect rect_a(cv::Point2f(a.box[0], a.box[1]),
+                         cv::Size2f(a.box[2], a.box[3]), a.theta);
+  cv::RotatedRect rect_b(cv::Point2f(b.box[0], b.box[1]),
+                         cv::Size2f(b.box[2], b.box[3]), b.theta);
+  std::vector<cv::Point2f> region;
+  cv::rotatedRectangleIntersection(rect_a, rect_b, region);
+  if (region.empty()) {
+    return 0;
+  }
+  double inter = cv::contourArea(region);
+  return inter / (a.box[2] * a.box[3] + b.box[2] * b.box[3] - inter);
+}
+
+static int reverse(float position, int boundary, int pad) {
+  return static_cast<int>(clamp(position - pad, 0, boundary) /
+                          kLetterBox.scale);
+}
+
+static void reference_decode(const SyntheticModel &model,
+                             const ModelOutputs &data, Task task, int top_k,
+                             object_detect_result_list *od_results) {
+  std::vector<ReferenceCandidate> candidates;
+  for (int b = 0; b < 3; ++b) {
+    int score_idx = b * model.outputs_per_branch + 1;
+    int plane = model.attrs[score_idx].dims[2] * model.attrs[score_idx].dims[3];
+    for (int cell = 0; cell < plane; ++cell) {
+      ReferenceCandidate candidate = {static_cast<float>(BOX_THRESH), -1, b,
+                                      cell};
+      for (int c = 0; c < model.class_num; ++c) {
+        float score = value_at(model, data, score_idx, cell, c);
+        if (score > candidate.score) {
+          candidate.score = score;
+          candidate.cls_id = c;
+        }
+      }
+      if (candidate.cls_id >= 0) {
+        reference_box(model, data, task, &candidate);
+        candidates.push_back(candidate);
+      }
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const ReferenceCandidate &a,
+                      const ReferenceCandidate &b) {
+                     return a.score > b.score;
+                   });
+  // yolov10没有NMS，最多保留OBJ_NUMB_MAX_SIZE个
+  int keep = top_k > 0 ? top_k : candidates.size();
+  if (task == Task::V10_DETECTION) {
+    keep = std::min(keep, OBJ_NUMB_MAX_SIZE);
+  }
+  if (static_cast<int>(candidates.size()) > keep) {
+    candidates.resize(keep);
+  }
+  // 按分数从高到低依次保留，抑制同一类别中重叠的框，姿态只有一个类别
+  std::vector<bool> removed(candidates.size(), false);
+  for (size_t i = 0; task != Task::V10_DETECTION && i < candidates.size();
+       ++i) {
+    for (size_t j = i + 1; !removed[i] && j < candidates.size(); ++j) {
+      if (removed[j] || candidates[j].cls_id != candidates[i].cls_id) {
+        continue;
+      }
+      float iou = task == Task::OBB
+                      ? rotated_iou(candidates[i], candidates[j])
+                      : box_iou(candidates[i].box, candidates[j].box);
+      if (iou > NMS_THRESH) {
+        removed[j] = true;
+      }
+    }
+  }
+  memset(od_results, 0, sizeof(object_detect_result_list));
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (removed[i] || od_results->count >= OBJ_NUMB_MAX_SIZE) {
+      continue;
+    }
+    const ReferenceCandidate &candidate = candidates[i];
+    const float *box = candidate.box;
+    int n = od_results->count++;
+    if (task == Task::OBB) {
+      auto &obb = od_results->results_obb[n];
+      obb.box.x = static_cast<int>((box[0] - kLetterBox.x_pad) /
+                                   kLetterBox.scale);
+      obb.box.y = static_cast<int>((box[1] - kLetterBox.y_pad) /
+                                   kLetterBox.scale);
+      obb.box.w = static_cast<int>(box[2] / kLetterBox.scale);
+      obb.box.h = static_cast<int>(box[3] / kLetterBox.scale);
+      obb.box.theta = candidate.theta;
+      obb.prop = candidate.score;
+      obb.cls_id = candidate.cls_id;
+      continue;
+    }
+    auto &result = od_results->results[n];
+    result.box.left = reverse(box[0], 640, kLetterBox.x_pad);
+    result.box.top = reverse(box[1], 640, kLetterBox.y_pad);
+    result.box.right = reverse(box[0] + box[2], 640, kLetterBox.x_pad);
+    result.box.bottom = reverse(box[1] + box[3], 640, kLetterBox.y_pad);
+    result.prop = candidate.score;
+    result.cls_id = task == Task::POSE ? 0 : candidate.cls_id;
+    if (task != Task::POSE) {
+      continue;
+    }
+    // 关键点已经是模型输入上的坐标
+    int kpt_idx = candidate.branch * model.outputs_per_branch + 2;
+    auto &pose = od_results->results_pose[n];
+    for (int k = 0; k < 17; ++k) {
+      float x = value_at(model, data, kpt_idx, candidate.cell, 2 * k);
+      float y = value_at(model, data, kpt_idx, candidate.cell, 2 * k + 1);
+      pose.kpt[2 * k] = (x - kLetterBox.x_pad) / kLetterBox.scale;
+      pose.kpt[2 * k + 1] = (y - kLetterBox.y_pad) / kLetterBox.scale;
+      pose.visibility[k] =
+          value_at(model, data, kpt_idx + 1, candidate.cell, k);
+    }
+  }
+}
+
+static float result_prop(Task task, const object_detect_result_list &list,
+                         int i) {
+  return task == Task::OBB ? list.results_obb[i].prop : list.results[i].prop;
+}
+
+// 框是DFL的期望，参考解码的浮点运算顺序不同，允许相差一个像素
+static bool within_pixel(int a, int b) { return std::abs(a - b) <= 1; }
+
+static bool same_object(Task task, const object_detect_result_list &a, int i,
+                        const object_detect_result_list &b, int j) {
+  if (task == Task::OBB) {
+    const auto &x = a.results_obb[i];
+    const auto &y = b.results_obb[j];
+    return x.prop == y.prop && x.cls_id == y.cls_id &&
+           x.box.theta == y.box.theta && within_pixel(x.box.x, y.box.x) &&
+           within_pixel(x.box.y, y.box.y) && within_pixel(x.box.w, y.box.w) &&
+           within_pixel(x.box.h, y.box.h);
+  }
+  const auto &x = a.results[i];
+  const auto &y = b.results[j];
+  if (x.prop != y.prop || x.cls_id != y.cls_id ||
+      !within_pixel(x.box.left, y.box.left) || !within_pixel(x.box.top, y.box.top) ||
+      !within_pixel(x.box.right, y.box.right) || !within_pixel(x.box.bottom, y.box.bottom)) {
+    return false;
+  }
+  return task != Task::POSE ||
+         memcmp(&a.results_pose[i], &b.results_pose[j],
+                sizeof(object_pose_result)) == 0;
+}
+
+// 分数的顺序必须相同；分数相同的目标（只有yolov10的输入有）顺序不确定，
+// 在参考结果中找一个没有用过的同一目标
+static bool same_results(Task task, const object_detect_result_list &reference,
+                         const object_detect_result_list &result) {
+  if (reference.count != result.count) {
+    return false;
+  }
+  std::vector<bool> used(reference.count, false);
+  for (int i = 0; i < result.count; ++i) {
+    if (result_prop(task, result, i) != result_prop(task, reference, i)) {
+      return false;
+    }
+    bool found = false;
+    for (int j = 0; j < reference.count && !found; ++j) {
+      if (!used[j] && same_object(task, result, i, reference, j)) {
+        used[j] = true;
+        found = true;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct TestCase {
+  const char *name;
+  Task task;
+  SyntheticModel model;
+  std::vector<int> top_ks;
+};
+
+int main() {
+  init_test_labels();
+  ThreadPool decode_pool(3);
+  // 姿态模型每个分支是box、score、17个关键点的坐标和可见度，
+  // 旋转框模型是box、score和角度
+  std::vector<TestCase> cases;
+  cases.push_back({"v8", Task::DETECTION,
+                   make_model(OBJ_CLASS_NUM, {}, kCandidates, 1, 3),
+                   {kTopK, 0}});
+  cases.push_back({"v10", Task::V10_DETECTION,
+                   make_model(OBJ_CLASS_NUM, {}, kV10Candidates, kV10Ties, 5),
+                   {PRE_NMS_TOP_K, kTopK}});
+  cases.push_back(
+      {"pose", Task::POSE,
+       make_model(1, {{34, -128, 2.5f}, {17, -128, 1.0f / 255}}, kCandidates,
+                  1, 7),
+       {kTopK, 0}});
+  cases.push_back({"obb", Task::OBB,
+                   make_model(kObbClassNum, {{1, 0, static_cast<float>(M_PI) / 255}},
+                              kCandidates, 1, 9),
+                   {kTopK, 0}});
+  auto reference = std::make_unique<object_detect_result_list>();
+  auto result = std::make_unique<object_detect_result_list>();
+  for (const auto &test : cases) {
+    if (test.task == Task::POSE) {
+      // 姿态和旋转框的后处理按模型的输出修改类别数量，先释放标签
+      deinit_post_process();
+    }
+    for (DataType type : {DataType::INT8, DataType::FP16, DataType::FP32}) {
+      ModelOutputs data = make_outputs(test.model, type);
+      for (int top_k : test.top_ks) {
+        reference_decode(test.model, data, test.task, top_k, reference.get());
+        for (ThreadPool *pool : {static_cast<ThreadPool *>(nullptr), &decode_pool}) {
+          run(test.model, data, test.task, type, top_k, pool, result.get());
+          bool same = same_results(test.task, *reference, *result);
+          printf("%s %s top_k %d%s: %d results, %s\n", test.name,
+                 type_name(type), top_k, pool ? " (decode pool)" : "",
+                 result->count, same ? "match" : "mismatch");
+          EXPECT_TRUE(same);
+        }
+        if (test.task == Task::V10_DETECTION) {
+          // 有界堆的容量是OBJ_NUMB_MAX_SIZE和pre_nms_top_k中较小的一个
+          EXPECT_TRUE(result->count == std::min(OBJ_NUMB_MAX_SIZE, top_k));
+        } else if (top_k > 0) {
+          EXPECT_TRUE(result->count <= top_k);
+        } else {
+          // 不限制时保留下来的目标多于kTopK，截断确实起了作用
+          EXPECT_TRUE(result->count > kTopK);
+        }
+      }
+    }
+  }
+  return finish_test("postprocess_test");
+}
@@ -0,0 +1,87 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "chrono"
+#include "cstdio"
+#include "label_renderer.h"
+#include "postprocess.h"
+#include "random"
+#include "string"
+#include "vector"
+
+// 检测框和标签的绘制：预先栅格化的字形（LabelRenderer和draw_box），对比原来
+// 每个目标sprintf、cv::putText和cv::rectangle的方式，按检测数量输出每帧耗时
+// 用法：render_bench [width height [iterations]]
+struct Detection {
+  cv::Rect box;
+  int cls_id;
+  float prop;
+};
+
+static std::vector<Detection> make_detections(int count, cv::Size size) {
+  std::mt19937 rng(count + 1);
+  std::vector<Detection> detections;
+  for (int i = 0; i < count; ++i) {
+    int w = 40 + rng() % (size.width / 4);
+    int h = 40 + rng() % (size.height / 4);
+    int x = rng() % (size.width - w);
+    int y = rng() % (size.height - h);
+    detections.push_back({cv::Rect(x, y, w, h),
+                          static_cast<int>(rng() % OBJ_CLASS_NUM),
+                          0.25f + (rng() % 750) / 1000.0f});
+  }
+  return detections;
+}
+
+template <typename Func>
+static double average_us(int iterations, Func func) {
+  func();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    func();
+  }
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         iterations;
+}
+
+int main(int argc, char **argv) {
+  cv::Size size(argc > 2 ? atoi(argv[1]) : 1920,
+                argc > 2 ? atoi(argv[2]) : 1080);
+  int iterations = argc > 3 ? atoi(argv[3]) : 100;
+  std::string label_path = YOLOV8_LABEL_PATH;
+  init_post_process(label_path);
+  // 和ImageProcess::ProcessDetectionImage相同的字体、颜色和线宽
+  LabelRenderer renderer(cv::FONT_HERSHEY_COMPLEX, 1, 2, true);
+  cv::Mat image(size, CV_8UC3, cv::Scalar(114, 114, 114));
+  printf("%dx%d, us per frame\n", size.width, size.height);
+  printf("%10s %12s %12s\n", "detections", "putText", "atlas");
+  for (int count : {1, 5, 10, 20, 50, 100}) {
+    auto detections = make_detections(count, size);
+    double put_text = average_us(iterations, [&] {
+      for (const auto &det : detections) {
+        cv::rectangle(image, det.box.tl(), det.box.br(),
+                      cv::Scalar(0, 0, 255), 2);
+        char text[256];
+        sprintf(text, "%s %.1f%%", coco_cls_to_name(det.cls_id),
+                det.prop * 100);
+        cv::putText(image, text, cv::Point(det.box.x, det.box.y + 20),
+                    cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 0, 0), 2,
+                    cv::LINE_8);
+      }
+    });
+    double atlas = average_us(iterations, [&] {
+      for (const auto &det : detections) {
+        draw_box(image, det.box, cv::Scalar(0, 0, 255), 2);
+        renderer.DrawLabel(image, det.cls_id, det.prop,
+                           cv::Point(det.box.x, det.box.y + 20),
+                           cv::Scalar(255, 0, 0));
+      }
+    });
+    printf("%10d %12.0f %12.0f\n", count, put_text, atlas);
+  }
+  deinit_post_process();
+  return 0;
+}
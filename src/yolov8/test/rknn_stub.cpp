@@ -0,0 +1,290 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "rknn_stub.h"
+
+#include "algorithm"
+#include "atomic"
+#include "map"
+#include "memory"
+#include "mutex"
+#include "thread"
+
+namespace {
+
+struct StubContext {
+  rknn_core_mask core_mask{RKNN_NPU_CORE_AUTO};
+  int frame_id{0};  // 最近一次rknn_inputs_set的帧号
+  std::vector<rknn_tensor_mem *> bound_mems;
+  std::atomic<int> running{0};
+  StubStats stats;
+};
+
+std::mutex g_mutex;
+StubModel g_model;
+std::map<rknn_context, std::unique_ptr<StubContext>> g_contexts;
+std::map<int, std::chrono::microseconds> g_latencies;
+rknn_context g_next_context = 1;
+
+StubContext *find_context(rknn_context context) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  auto it = g_contexts.find(context);
+  return it == g_contexts.end() ? nullptr : it->second.get();
+}
+
+rknn_context create_context() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  rknn_context context = g_next_context++;
+  g_contexts[context] = std::make_unique<StubContext>();
+  g_contexts[context]->bound_mems.resize(g_model.output_attrs.size());
+  return context;
+}
+
+const std::vector<uint8_t> &output_data(int frame_id, int index) {
+  const auto &sets = g_model.output_sets;
+  return sets[frame_id % sets.size()][index];
+}
+
+}  // namespace
+
+void rknn_stub_set_model(const StubModel &model) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_model = model;
+}
+
+void rknn_stub_set_latency(rknn_core_mask core_mask,
+                           std::chrono::microseconds latency) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_latencies[core_mask] = latency;
+}
+
+StubStats rknn_stub_get_stats(rknn_context context) {
+  StubContext *ctx = find_context(context);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return ctx == nullptr ? StubStats() : ctx->stats;
+}
+
+void rknn_stub_reset_stats() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  for (auto &context : g_contexts) {
+    context.second->stats = StubStats();
+  }
+}
+
+rknn_tensor_attr stub_tensor_attr(int index, uint32_t channel, uint32_t height,
+                                  uint32_t width, rknn_tensor_type type,
+                                  int32_t zp, float scale) {
+  rknn_tensor_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.index = index;
+  attr.n_dims = 4;
+  attr.dims[0] = 1;
+  attr.dims[1] = channel;
+  attr.dims[2] = height;
+  attr.dims[3] = width;
+  attr.n_elems = channel * height * width;
+  attr.fmt = RKNN_TENSOR_NCHW;
+  attr.type = type;
+  attr.qnt_type = type == RKNN_TENSOR_INT8 ? RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC
+                                           : RKNN_TENSOR_QNT_NONE;
+  attr.zp = zp;
+  attr.scale = scale;
+  uint32_t elem_size = type == RKNN_TENSOR_FLOAT32
+                           ? 4
+                           : (type == RKNN_TENSOR_FLOAT16 ? 2 : 1);
+  attr.size = attr.n_elems * elem_size;
+  attr.size_with_stride = attr.size;
+  snprintf(attr.name, RKNN_MAX_NAME_LEN, "output%d", index);
+  return attr;
+}
+
+rknn_tensor_attr stub_input_attr(uint32_t height, uint32_t width,
+                                 uint32_t channel) {
+  rknn_tensor_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.n_dims = 4;
+  attr.dims[0] = 1;
+  attr.dims[1] = height;
+  attr.dims[2] = width;
+  attr.dims[3] = channel;
+  attr.n_elems = height * width * channel;
+  attr.size = attr.n_elems;
+  attr.fmt = RKNN_TENSOR_NHWC;
+  attr.type = RKNN_TENSOR_UINT8;
+  snprintf(attr.name, RKNN_MAX_NAME_LEN, "images");
+  return attr;
+}
+
+int rknn_init(rknn_context *context, void *model, uint32_t size, uint32_t flag,
+              rknn_init_extend *extend) {
+  *context = create_context();
+  return RKNN_SUCC;
+}
+
+int rknn_dup_context(rknn_context *context_in, rknn_context *context_out) {
+  if (find_context(*context_in) == nullptr) {
+    return -1;
+  }
+  *context_out = create_context();
+  return RKNN_SUCC;
+}
+
+int rknn_destroy(rknn_context context) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_contexts.erase(context);
+  return RKNN_SUCC;
+}
+
+int rknn_query(rknn_context context, rknn_query_cmd cmd, void *info,
+               uint32_t size) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  switch (cmd) {
+    case RKNN_QUERY_SDK_VERSION: {
+      auto version = static_cast<rknn_sdk_version *>(info);
+      snprintf(version->api_version, sizeof(version->api_version), "stub");
+      snprintf(version->drv_version, sizeof(version->drv_version), "stub");
+      return RKNN_SUCC;
+    }
+    case RKNN_QUERY_IN_OUT_NUM: {
+      auto io_num = static_cast<rknn_input_output_num *>(info);
+      io_num->n_input = 1;
+      io_num->n_output = g_model.output_attrs.size();
+      return RKNN_SUCC;
+    }
+    case RKNN_QUERY_INPUT_ATTR:
+      *static_cast<rknn_tensor_attr *>(info) = g_model.input_attr;
+      return RKNN_SUCC;
+    case RKNN_QUERY_OUTPUT_ATTR: {
+      auto attr = static_cast<rknn_tensor_attr *>(info);
+      *attr = g_model.output_attrs[attr->index];
+      return RKNN_SUCC;
+    }
+    case RKNN_QUERY_NATIVE_OUTPUT_ATTR: {
+      if (g_model.native_output_attrs.empty()) {
+        return -1;
+      }
+      auto attr = static_cast<rknn_tensor_attr *>(info);
+      *attr = g_model.native_output_attrs[attr->index];
+      return RKNN_SUCC;
+    }
+    default:
+      return -1;
+  }
+}
+
+int rknn_inputs_set(rknn_context context, uint32_t n_inputs,
+                    rknn_input inputs[]) {
+  StubContext *ctx = find_context(context);
+  if (ctx == nullptr || n_inputs < 1 || inputs[0].buf == nullptr) {
+    return -1;
+  }
+  memcpy(&ctx->frame_id, inputs[0].buf, sizeof(ctx->frame_id));
+  return RKNN_SUCC;
+}
+
+int rknn_set_core_mask(rknn_context context, rknn_core_mask core_mask) {
+  StubContext *ctx = find_context(context);
+  if (ctx == nullptr) {
+    return -1;
+  }
+  ctx->core_mask = core_mask;
+  return RKNN_SUCC;
+}
+
+int rknn_set_batch_core_num(rknn_context context, int core_num) {
+  return RKNN_SUCC;
+}
+
+int rknn_run(rknn_context context, rknn_run_extend *extend) {
+  StubContext *ctx = find_context(context);
+  if (ctx == nullptr) {
+    return -1;
+  }
+  int running = ctx->running.fetch_add(1) + 1;
+  std::chrono::microseconds latency{0};
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_latencies.find(ctx->core_mask);
+    if (it != g_latencies.end()) {
+      latency = it->second;
+    }
+  }
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(latency);
+  // NPU把结果直接写入绑定的内存
+  for (size_t i = 0; i < ctx->bound_mems.size(); ++i) {
+    rknn_tensor_mem *mem = ctx->bound_mems[i];
+    if (mem != nullptr) {
+      const auto &data = output_data(ctx->frame_id, i);
+      memcpy(mem->virt_addr, data.data(), std::min<size_t>(mem->size,
+                                                           data.size()));
+    }
+  }
+  auto busy = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    ctx->stats.runs++;
+    ctx->stats.busy += busy;
+    ctx->stats.max_concurrent_runs =
+        std::max(ctx->stats.max_concurrent_runs, running);
+  }
+  ctx->running--;
+  return RKNN_SUCC;
+}
+
+int rknn_wait(rknn_context context, rknn_run_extend *extend) {
+  return RKNN_SUCC;
+}
+
+int rknn_outputs_get(rknn_context context, uint32_t n_outputs,
+                     rknn_output outputs[], rknn_output_extend *extend) {
+  StubContext *ctx = find_context(context);
+  if (ctx == nullptr) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < n_outputs; ++i) {
+    const auto &data = output_data(ctx->frame_id, outputs[i].index);
+    // 只支持预先分配的输出，和Yolov8的用法一致
+    if (!outputs[i].is_prealloc || outputs[i].size < data.size()) {
+      return -1;
+    }
+    memcpy(outputs[i].buf, data.data(), data.size());
+  }
+  return RKNN_SUCC;
+}
+
+int rknn_outputs_release(rknn_context context, uint32_t n_ouputs,
+                         rknn_output outputs[]) {
+  return RKNN_SUCC;
+}
+
+rknn_tensor_mem *rknn_create_mem(rknn_context ctx, uint32_t size) {
+  auto mem = new rknn_tensor_mem();
+  memset(mem, 0, sizeof(rknn_tensor_mem));
+  mem->virt_addr = calloc(1, size);
+  mem->size = size;
+  return mem;
+}
+
+int rknn_destroy_mem(rknn_context ctx, rknn_tensor_mem *mem) {
+  free(mem->virt_addr);
+  delete mem;
+  return RKNN_SUCC;
+}
+
+int rknn_set_io_mem(rknn_context ctx, rknn_tensor_mem *mem,
+                    rknn_tensor_attr *attr) {
+  StubContext *context = find_context(ctx);
+  if (context == nullptr || attr->index >= context->bound_mems.size()) {
+    return -1;
+  }
+  context->bound_mems[attr->index] = mem;
+  return RKNN_SUCC;
+}
+
+int rknn_mem_sync(rknn_context context, rknn_tensor_mem *mem,
+                  rknn_mem_sync_mode mode) {
+  return RKNN_SUCC;
+}
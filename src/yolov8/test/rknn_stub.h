@@ -0,0 +1,42 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#pragma once
+#include "chrono"
+#include "rknn_api.h"
+#include "vector"
+
+// 模拟的rknn运行时，在主机上测试调度、流水线和后处理，不需要NPU和librknnrt
+// rknn_run按上下文绑定的核心睡眠一段时间；输入的前4个字节是帧号，输出的内容
+// 按帧号在output_sets中轮流选择，测试可以据此检查每一帧拿到的是不是自己的结果
+struct StubModel {
+  rknn_tensor_attr input_attr;
+  std::vector<rknn_tensor_attr> output_attrs;
+  // 为空时RKNN_QUERY_NATIVE_OUTPUT_ATTR返回错误，输出由rknn_outputs_get复制
+  std::vector<rknn_tensor_attr> native_output_attrs;
+  // output_sets[k][i]是第k组的第i个输出，按原样交给调用者（不做类型转换）
+  std::vector<std::vector<std::vector<uint8_t>>> output_sets;
+};
+
+struct StubStats {
+  int runs{0};
+  int max_concurrent_runs{0};  // 同一个上下文同时执行rknn_run的最大数量
+  std::chrono::microseconds busy{0};
+};
+
+// 在rknn_init之前设置，之后创建的上下文都使用这个模型
+void rknn_stub_set_model(const StubModel &model);
+// 绑定到core_mask的上下文每次rknn_run的耗时，默认为0
+void rknn_stub_set_latency(rknn_core_mask core_mask,
+                           std::chrono::microseconds latency);
+StubStats rknn_stub_get_stats(rknn_context context);
+void rknn_stub_reset_stats();
+
+// 构造NCHW的输出属性
+rknn_tensor_attr stub_tensor_attr(int index, uint32_t channel, uint32_t height,
+                                  uint32_t width, rknn_tensor_type type,
+                                  int32_t zp = 0, float scale = 1.0f);
+// 构造NHWC的uint8输入属性
+rknn_tensor_attr stub_input_attr(uint32_t height, uint32_t width,
+                                 uint32_t channel = 3);
@@ -0,0 +1,70 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include <linux/videodev2.h>
+
+#include "chrono"
+#include "cstdio"
+#include "image_process.h"
+#include "random"
+#include "raw_frame.h"
+#include "string"
+#include "vector"
+
+// YUYV/NV12到模型输入：ConvertYuv一次完成，对比原来的三次遍历
+// （cvtColor到BGR、ImageProcess::Convert缩放填充、cvtColor到RGB写入输入）
+// 用法：yuv_convert_bench [width height [yuyv|nv12 [iterations]]]
+template <typename Func>
+static double average_us(int iterations, Func func) {
+  for (int i = 0; i < 5; ++i) {
+    func();
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    func();
+  }
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         iterations;
+}
+
+int main(int argc, char **argv) {
+  int width = argc > 2 ? atoi(argv[1]) : 1920;
+  int height = argc > 2 ? atoi(argv[2]) : 1080;
+  std::string format = argc > 3 ? argv[3] : "yuyv";
+  int iterations = argc > 4 ? atoi(argv[4]) : 200;
+  const int target_size = 640;
+  uint32_t fourcc = format == "nv12" ? V4L2_PIX_FMT_NV12 : V4L2_PIX_FMT_YUYV;
+  size_t frame_size = format == "nv12" ? width * height * 3 / 2
+                                       : width * height * 2;
+  std::vector<uint8_t> data(frame_size);
+  std::mt19937 rng(1);
+  for (auto &value : data) {
+    value = rng() % 256;
+  }
+  RawFrame frame = {data.data(), frame_size, fourcc, width, height,
+                    std::chrono::steady_clock::now(), 0};
+  ImageProcess image_process(width, height, target_size);
+  std::vector<uint8_t> input(target_size * target_size * 3);
+
+  double one_pass = average_us(iterations, [&] {
+    image_process.ConvertYuv(frame, input.data());
+  });
+  cv::Mat yuv = format == "nv12"
+                    ? cv::Mat(height * 3 / 2, width, CV_8UC1, data.data())
+                    : cv::Mat(height, width, CV_8UC2, data.data());
+  cv::Mat bgr;
+  double three_pass = average_us(iterations, [&] {
+    cv::cvtColor(yuv, bgr, format == "nv12" ? cv::COLOR_YUV2BGR_NV12
+                                            : cv::COLOR_YUV2BGR_YUYV);
+    auto letterbox = image_process.Convert(bgr);
+    cv::Mat rgb(target_size, target_size, CV_8UC3, input.data());
+    cv::cvtColor(*letterbox, rgb, cv::COLOR_BGR2RGB);
+  });
+  printf("%dx%d %s -> %d: ConvertYuv %.0fus, cvtColor + Convert + cvtColor "
+         "%.0fus per frame\n",
+         width, height, format.c_str(), target_size, one_pass, three_pass);
+  return 0;
+}
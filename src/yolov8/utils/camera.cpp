@@ -4,10 +4,14 @@
 
 #include "camera.h"
 
+#include <linux/videodev2.h>
+
+#include "frame_pool.h"
 #include "kaylordut/log/logger.h"
 #include "thread"
 
-Camera::Camera(uint16_t index, cv::Size size, double framerate)
+Camera::Camera(uint16_t index, cv::Size size, double framerate,
+               const std::string &pixel_format)
     : capture_(index, cv::CAP_V4L2), size_(size) {
   KAYLORDUT_LOG_INFO("Instantiate a Camera object");
   // 这里使用V4L2捕获，因为使用默认的捕获不可以设置捕获的模式和帧率
@@ -15,19 +19,31 @@ Camera::Camera(uint16_t index, cv::Size size, double framerate)
     KAYLORDUT_LOG_ERROR("Error opening video stream or file");
     exit(EXIT_FAILURE);
   }
-  capture_.set(cv::CAP_PROP_FOURCC,
-               cv::VideoWriter::fourcc('M', 'J', 'P', 'G'));
+  if (!parse_pixel_format(pixel_format, &fourcc_)) {
+    KAYLORDUT_LOG_ERROR("Invalid pixel format: {}", pixel_format);
+    exit(EXIT_FAILURE);
+  }
+  // V4L2的fourcc和OpenCV的fourcc编码方式相同
+  capture_.set(cv::CAP_PROP_FOURCC, fourcc_);
   // 检查是否成功设置格式
-  int fourcc = capture_.get(cv::CAP_PROP_FOURCC);
-  if (fourcc != cv::VideoWriter::fourcc('M', 'J', 'P', 'G')) {
+  uint32_t fourcc = capture_.get(cv::CAP_PROP_FOURCC);
+  if (fourcc != fourcc_) {
     KAYLORDUT_LOG_WARN("Set video format failed");
   }
+  // YUV格式直接输出原始数据，由ImageProcess::ConvertYuv一次完成转换和缩放
+  raw_ = is_yuv_format(fourcc_);
+  if (raw_ && !capture_.set(cv::CAP_PROP_CONVERT_RGB, 0)) {
+    KAYLORDUT_LOG_WARN("Disable RGB conversion failed");
+  }
   capture_.set(cv::CAP_PROP_FRAME_WIDTH, size_.width);
   capture_.set(cv::CAP_PROP_FRAME_HEIGHT, size_.height);
   if (!capture_.set(cv::CAP_PROP_FPS, framerate)) {
     KAYLORDUT_LOG_WARN("set framerate failed!!");
   }
   std::this_thread::sleep_for(std::chrono::seconds(1));
+  // 原始数据按照实际的分辨率解析
+  size_ = cv::Size(capture_.get(cv::CAP_PROP_FRAME_WIDTH),
+                   capture_.get(cv::CAP_PROP_FRAME_HEIGHT));
   KAYLORDUT_LOG_INFO("camera width: {}, height: {}, fps: {}",
                      capture_.get(cv::CAP_PROP_FRAME_WIDTH),
                      capture_.get(cv::CAP_PROP_FRAME_HEIGHT),
@@ -41,12 +57,37 @@ Camera::~Camera() {
   }
 }
 
-std::unique_ptr<cv::Mat> Camera::GetNextFrame() {
-  auto frame = std::make_unique<cv::Mat>();
+std::shared_ptr<cv::Mat> Camera::GetNextFrame() {
+  // 尺寸和类型一致时，VideoCapture直接写入池里的缓冲区
+  auto frame =
+      FramePool::GetInstance().Acquire(size_.height, size_.width, CV_8UC3);
   capture_ >> *frame;
   if (frame->empty()) {
     KAYLORDUT_LOG_ERROR("Get frame error");
     return nullptr;
   }
-  return std::move(frame);
-}
\ No newline at end of file
+  return frame;
+}
+std::shared_ptr<RawFrame> Camera::GetNextRawFrame() {
+  // 按照原始数据的布局从池里取，后端的布局不同时cv::Mat会自己重新分配
+  auto frame = fourcc_ == V4L2_PIX_FMT_NV12
+                   ? FramePool::GetInstance().Acquire(size_.height * 3 / 2,
+                                                      size_.width, CV_8UC1)
+                   : FramePool::GetInstance().Acquire(size_.height,
+                                                      size_.width, CV_8UC2);
+  capture_ >> *frame;
+  if (frame->empty()) {
+    KAYLORDUT_LOG_ERROR("Get frame error");
+    return nullptr;
+  }
+  // deleter持有cv::Mat，原始数据和帧一起释放
+  return std::shared_ptr<RawFrame>(
+      new RawFrame{frame->data, frame->total() * frame->elemSize(), fourcc_,
+                   size_.width, size_.height, std::chrono::steady_clock::now(),
+                   sequence_++},
+      [frame](RawFrame *raw_frame) { delete raw_frame; });
+}
+
+bool Camera::is_raw() { return raw_; }
+
+cv::Size Camera::get_size() { return size_; }
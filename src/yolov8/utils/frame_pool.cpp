@@ -0,0 +1,75 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "frame_pool.h"
+
+#include "cstdlib"
+#include "cstring"
+#include "kaylordut/log/logger.h"
+
+// 按页对齐，也按页的整数倍分级，相近分辨率的帧可以共用
+static const size_t kAlignment = 4096;
+
+FramePool &FramePool::GetInstance() {
+  // 不析构：退出时可能还有帧没有释放，它们的deleter仍然需要访问这个池
+  static FramePool *pool = new FramePool();
+  return *pool;
+}
+
+std::shared_ptr<cv::Mat> FramePool::Acquire(int rows, int cols, int type) {
+  size_t size = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+  size_t size_class = (size + kAlignment - 1) / kAlignment * kAlignment;
+  void *buffer = AllocateBuffer(size_class);
+  return std::shared_ptr<cv::Mat>(
+      new cv::Mat(rows, cols, type, buffer),
+      [this, buffer, size_class](cv::Mat *mat) {
+        // mat可能被重新create过，归还的总是原来的缓冲区
+        delete mat;
+        ReleaseBuffer(buffer, size_class);
+      });
+}
+
+void *FramePool::AllocateBuffer(size_t size_class) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &buffers = free_buffers_[size_class];
+    if (!buffers.empty()) {
+      void *buffer = buffers.back();
+      buffers.pop_back();
+      return buffer;
+    }
+    allocated_bytes_ += size_class;
+  }
+  void *buffer = aligned_alloc(kAlignment, size_class);
+  if (buffer == nullptr) {
+    KAYLORDUT_LOG_ERROR("Out of memory: allocate {} bytes", size_class);
+    exit(EXIT_FAILURE);
+  }
+  // 分配时就触发缺页，之后复用不会再有缺页
+  memset(buffer, 0, size_class);
+  return buffer;
+}
+
+void FramePool::ReleaseBuffer(void *buffer, size_t size_class) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &buffers = free_buffers_[size_class];
+    if (buffers.size() < max_free_per_class_) {
+      buffers.push_back(buffer);
+      return;
+    }
+    allocated_bytes_ -= size_class;
+  }
+  free(buffer);
+}
+
+void FramePool::set_max_free_per_class(size_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_free_per_class_ = count;
+}
+
+size_t FramePool::get_allocated_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return allocated_bytes_;
+}
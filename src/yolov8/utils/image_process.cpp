@@ -5,7 +5,15 @@
 #include "image_process.h"
 
 #include "BYTETracker.h"
+#include "frame_pool.h"
 #include "kaylordut/log/logger.h"
+#include "kaylordut/time/time_duration.h"
+#include "label_renderer.h"
+#include "mask_blend.h"
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include <linux/videodev2.h>
 #define N_CLASS_COLORS (20)
 unsigned char class_colors[][3] = {
     {255, 56, 56},    // 'FF3838'
@@ -31,7 +39,9 @@ unsigned char class_colors[][3] = {
 };
 
 ImageProcess::ImageProcess(int width, int height, int target_size,
-                           bool is_track, int framerate) {
+                           bool is_track) {
+  width_ = width;
+  height_ = height;
   scale_ = static_cast<double>(target_size) / std::max(height, width);
   padding_x_ = target_size - static_cast<int>(width * scale_);
   padding_y_ = target_size - static_cast<int>(height * scale_);
@@ -42,74 +52,259 @@ ImageProcess::ImageProcess(int width, int height, int target_size,
   letterbox_.x_pad = padding_x_ / 2;
   letterbox_.y_pad = padding_y_ / 2;
   is_track_ = is_track;
-  if (is_track) {
-    tracker_ = std::make_unique<BYTETracker>(framerate, 30);
+  // 最近邻采样，取目标像素中心对应的原图像素
+  map_x_.resize(new_size_.width);
+  for (int x = 0; x < new_size_.width; ++x) {
+    map_x_[x] = std::min(width - 1, static_cast<int>((x + 0.5) / scale_));
+  }
+  map_y_.resize(new_size_.height);
+  for (int y = 0; y < new_size_.height; ++y) {
+    map_y_[y] = std::min(height - 1, static_cast<int>((y + 0.5) / scale_));
   }
 }
 
-std::unique_ptr<cv::Mat> ImageProcess::Convert(const cv::Mat &src) {
+std::shared_ptr<cv::Mat> ImageProcess::Convert(const cv::Mat &src) {
   if (&src == nullptr) {
     return nullptr;
   }
-  cv::Mat resize_img;
-  cv::resize(src, resize_img, new_size_);
-  auto square_img = std::make_unique<cv::Mat>(
-      target_size_, target_size_, src.type(), cv::Scalar(114, 114, 114));
-  cv::Point position(padding_x_ / 2, padding_y_ / 2);
-  resize_img.copyTo((*square_img)(
-      cv::Rect(position.x, position.y, resize_img.cols, resize_img.rows)));
-  return std::move(square_img);
+  auto square_img =
+      FramePool::GetInstance().Acquire(target_size_, target_size_, src.type());
+  cv::Rect roi(padding_x_ / 2, padding_y_ / 2, new_size_.width,
+               new_size_.height);
+  // 只填充letterbox之外的区域，缩放结果直接写到square_img里
+  const cv::Scalar pad(114, 114, 114);
+  (*square_img)(cv::Rect(0, 0, target_size_, roi.y)).setTo(pad);
+  (*square_img)(cv::Rect(0, roi.y + roi.height, target_size_,
+                         target_size_ - roi.y - roi.height))
+      .setTo(pad);
+  (*square_img)(cv::Rect(0, roi.y, roi.x, roi.height)).setTo(pad);
+  (*square_img)(cv::Rect(roi.x + roi.width, roi.y,
+                         target_size_ - roi.x - roi.width, roi.height))
+      .setTo(pad);
+  cv::Mat letterbox = (*square_img)(roi);
+  cv::resize(src, letterbox, new_size_);
+  return square_img;
+}
+
+// BT.601（limited range）定点转换，系数放大64倍，和OpenCV的YUV2RGB一致
+// R = 1.164(Y-16) + 1.596(V-128)
+// G = 1.164(Y-16) - 0.391(U-128) - 0.813(V-128)
+// B = 1.164(Y-16) + 2.018(U-128)
+static inline uint8_t ClampToByte(int value) {
+  return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+}
+
+static void YuvToRgbRow(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                        uint8_t *rgb, int count) {
+  int i = 0;
+#if defined(__ARM_NEON)
+  const int16x8_t y_offset = vdupq_n_s16(16);
+  const int16x8_t uv_offset = vdupq_n_s16(128);
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t y16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i))),
+                              y_offset);
+    int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + i))),
+                              uv_offset);
+    int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + i))),
+                              uv_offset);
+    int16x8_t y74 = vmulq_n_s16(y16, 74);
+    // 蓝色分量可能超出int16，使用饱和加法，截断之后结果相同
+    int16x8_t r = vqaddq_s16(y74, vmulq_n_s16(v16, 102));
+    int16x8_t g = vqsubq_s16(
+        vqsubq_s16(y74, vmulq_n_s16(u16, 25)), vmulq_n_s16(v16, 52));
+    int16x8_t b = vqaddq_s16(y74, vmulq_n_s16(u16, 129));
+    uint8x8x3_t pixels;
+    pixels.val[0] = vqrshrun_n_s16(r, 6);
+    pixels.val[1] = vqrshrun_n_s16(g, 6);
+    pixels.val[2] = vqrshrun_n_s16(b, 6);
+    vst3_u8(rgb + i * 3, pixels);
+  }
+#endif
+  for (; i < count; ++i) {
+    int y74 = (y[i] - 16) * 74;
+    int u0 = u[i] - 128;
+    int v0 = v[i] - 128;
+    rgb[i * 3 + 0] = ClampToByte((y74 + 102 * v0 + 32) >> 6);
+    rgb[i * 3 + 1] = ClampToByte((y74 - 25 * u0 - 52 * v0 + 32) >> 6);
+    rgb[i * 3 + 2] = ClampToByte((y74 + 129 * u0 + 32) >> 6);
+  }
+}
+
+bool ImageProcess::CheckYuvFrame(const RawFrame &frame) const {
+  if (frame.width != width_ || frame.height != height_) {
+    KAYLORDUT_LOG_ERROR("frame size {}x{} does not match the stream {}x{}",
+                        frame.width, frame.height, width_, height_);
+    return false;
+  }
+  if (!is_yuv_format(frame.fourcc)) {
+    KAYLORDUT_LOG_ERROR("Unsupported pixel format {:#x}", frame.fourcc);
+    return false;
+  }
+  return true;
+}
+
+bool ImageProcess::ConvertYuv(const RawFrame &frame, uint8_t *dst) const {
+  if (!CheckYuvFrame(frame)) {
+    return false;
+  }
+  const int row_bytes = target_size_ * 3;
+  const int pad_x = padding_x_ / 2;
+  const int pad_y = padding_y_ / 2;
+  // 上下的填充行
+  memset(dst, 114, pad_y * row_bytes);
+  int bottom = pad_y + new_size_.height;
+  memset(dst + bottom * row_bytes, 114, (target_size_ - bottom) * row_bytes);
+  // 先按列索引取出一行的Y/U/V，再整行转换，转换部分可以向量化
+  // 同一路视频的帧可能在多个推理线程中同时转换，每个线程复用自己的行缓冲区
+  static thread_local std::vector<uint8_t> yuv_rows;
+  // 宽度和指针放到局部变量：写uint8_t可能和任何内存重叠，否则每个像素都要
+  // 重新读取成员和vector里的指针
+  const int width = new_size_.width;
+  yuv_rows.resize(width * 3);
+  uint8_t *y_row = yuv_rows.data();
+  uint8_t *u_row = y_row + width;
+  uint8_t *v_row = u_row + width;
+  const int *map_x = map_x_.data();
+  for (int row = 0; row < new_size_.height; ++row) {
+    int sy = map_y_[row];
+    if (frame.fourcc == V4L2_PIX_FMT_YUYV) {
+      // Y0 U Y1 V，两个像素共用一组UV
+      const uint8_t *src = frame.data + sy * width_ * 2;
+      for (int x = 0; x < width; ++x) {
+        int sx = map_x[x];
+        y_row[x] = src[sx * 2];
+        u_row[x] = src[(sx & ~1) * 2 + 1];
+        v_row[x] = src[(sx & ~1) * 2 + 3];
+      }
+    } else {
+      // NV12：Y平面之后是交错的UV平面，2x2个像素共用一组UV
+      const uint8_t *src_y = frame.data + sy * width_;
+      const uint8_t *src_uv = frame.data + width_ * height_ + (sy / 2) * width_;
+      for (int x = 0; x < width; ++x) {
+        int sx = map_x[x];
+        y_row[x] = src_y[sx];
+        u_row[x] = src_uv[sx & ~1];
+        v_row[x] = src_uv[(sx & ~1) + 1];
+      }
+    }
+    uint8_t *dst_row = dst + (pad_y + row) * row_bytes;
+    memset(dst_row, 114, pad_x * 3);
+    YuvToRgbRow(y_row, u_row, v_row, dst_row + pad_x * 3, width);
+    int right = pad_x + width;
+    memset(dst_row + right * 3, 114, (target_size_ - right) * 3);
+  }
+  return true;
 }
 
 const letterbox_t &ImageProcess::get_letter_box() { return letterbox_; }
 
-void ImageProcess::ImagePostProcess(cv::Mat &image,
-                                    object_detect_result_list &od_results) {
-  KAYLORDUT_LOG_INFO("ImagePostProcess is called");
-  if (od_results.count >= 1) {
-    int width = image.rows;
-    int height = image.cols;
-    auto *ori_img = image.ptr();
-    int cls_id = od_results.results[0].cls_id;
-    uint8_t *seg_mask = od_results.results_seg[0].seg_mask;
-    float alpha = 0.5f;  // opacity
-    if (seg_mask != nullptr) {
-      for (int j = 0; j < height; j++) {
-        for (int k = 0; k < width; k++) {
-          int pixel_offset = 3 * (j * width + k);
-          if (seg_mask[j * width + k] != 0) {
-            ori_img[pixel_offset + 0] = (unsigned char)clamp(
-                class_colors[seg_mask[j * width + k] % N_CLASS_COLORS][0] *
-                        (1 - alpha) +
-                    ori_img[pixel_offset + 0] * alpha,
-                0, 255);  // r
-            ori_img[pixel_offset + 1] = (unsigned char)clamp(
-                class_colors[seg_mask[j * width + k] % N_CLASS_COLORS][1] *
-                        (1 - alpha) +
-                    ori_img[pixel_offset + 1] * alpha,
-                0, 255);  // g
-            ori_img[pixel_offset + 2] = (unsigned char)clamp(
-                class_colors[seg_mask[j * width + k] % N_CLASS_COLORS][2] *
-                        (1 - alpha) +
-                    ori_img[pixel_offset + 2] * alpha,
-                0, 255);  // b
-          }
-        }
+cv::Size ImageProcess::get_resized_size() const { return new_size_; }
+
+void ImageProcess::ScaleResults(double scale_x, double scale_y,
+                                object_detect_result_list *od_results) const {
+  for (int i = 0; i < od_results->count; ++i) {
+    auto &box = od_results->results[i].box;
+    box.left = box.left * scale_x;
+    box.top = box.top * scale_y;
+    box.right = box.right * scale_x;
+    box.bottom = box.bottom * scale_y;
+    if (od_results->model_type == ModelType::OBB) {
+      auto &obb = od_results->results_obb[i].box;
+      obb.x = obb.x * scale_x;
+      obb.y = obb.y * scale_y;
+      obb.w = obb.w * scale_x;
+      obb.h = obb.h * scale_y;
+    } else if (od_results->model_type == ModelType::POSE) {
+      auto &kpt = od_results->results_pose[i].kpt;
+      for (int j = 0; j < 17; ++j) {
+        kpt[j * 2 + 0] *= scale_x;
+        kpt[j * 2 + 1] *= scale_y;
       }
-      free(seg_mask);
     }
   }
+}
+
+void ImageProcess::ImagePostProcess(cv::Mat &image,
+                                    object_detect_result_list &od_results) {
+  KAYLORDUT_LOG_INFO("ImagePostProcess is called");
+  TimeDuration render_time;
+  bool scaled = image.cols != width_ || image.rows != height_;
   KAYLORDUT_LOG_INFO("model type is {}", od_results.model_type);
+  // 检测结果保持原图坐标，在副本上换算到图像的大小再绘制
+  object_detect_result_list *draw_results = &od_results;
+  std::unique_ptr<object_detect_result_list> scaled_results;
+  if (scaled && od_results.count > 0) {
+    scaled_results = std::make_unique<object_detect_result_list>(od_results);
+    ScaleResults(static_cast<double>(image.cols) / width_,
+                 static_cast<double>(image.rows) / height_,
+                 scaled_results.get());
+    draw_results = scaled_results.get();
+  }
+  if (od_results.model_type == ModelType::SEGMENT) {
+    ProcessSegmentImage(image, *draw_results);
+  }
   if (od_results.model_type == ModelType::DETECTION || od_results.model_type == ModelType::V10_DETECTION) {
-    if (is_track_) {
-      ProcessTrackImage(image, od_results);
-    } else {
-      ProcessDetectionImage(image, od_results);
+    // 跟踪模式下检测框由TrackingStage按顺序更新跟踪器之后再绘制
+    if (!is_track_) {
+      ProcessDetectionImage(image, *draw_results);
     }
   } else if (od_results.model_type == ModelType::OBB) {
-    ProcessOBBImage(image, od_results);
+    ProcessOBBImage(image, *draw_results);
   } else if (od_results.model_type == ModelType::POSE) {
-    ProcessPoseImage(image, od_results);
+    ProcessPoseImage(image, *draw_results);
+  }
+  KAYLORDUT_LOG_DEBUG(
+      "render {} detections cost {}us", od_results.count,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          render_time.DurationSinceLastTime())
+          .count());
+}
+
+// 每个类别的颜色按通道预先乘以权重
+struct MaskColorLut {
+  uint16_t bias[N_CLASS_COLORS][3];
+  MaskColorLut() {
+    for (int i = 0; i < N_CLASS_COLORS; ++i) {
+      mask_color_bias(class_colors[i], bias[i]);
+    }
+  }
+};
+static const MaskColorLut kMaskColorLut;
+
+void ImageProcess::ProcessSegmentImage(
+    cv::Mat &image, const object_detect_result_list &od_results) const {
+  const cv::Rect image_rect(0, 0, image.cols, image.rows);
+  cv::Mat resized;
+  for (int i = 0; i < od_results.count; ++i) {
+    const auto &seg_result = od_results.results_seg[i];
+    if (seg_result.seg_mask == nullptr) {
+      continue;
+    }
+    // 掩码只覆盖检测框，只需要混合检测框内的像素，一次处理一行
+    const auto &box = od_results.results[i].box;
+    cv::Rect box_rect(box.left, box.top, box.right - box.left,
+                      box.bottom - box.top);
+    cv::Mat mask(seg_result.height, seg_result.width, CV_8UC1,
+                 seg_result.seg_mask);
+    if (box_rect.size() != mask.size()) {
+      // 图像按比例解码时，掩码缩放到检测框在图像上的大小
+      if (box_rect.empty()) {
+        continue;
+      }
+      cv::resize(mask, resized, box_rect.size(), 0, 0, cv::INTER_NEAREST);
+      mask = resized;
+    }
+    cv::Rect roi = box_rect & image_rect;
+    if (roi.empty()) {
+      continue;
+    }
+    const uint16_t *bias =
+        kMaskColorLut.bias[od_results.results[i].cls_id % N_CLASS_COLORS];
+    for (int y = 0; y < roi.height; ++y) {
+      blend_mask_row(image.ptr(roi.y + y) + roi.x * 3,
+                   mask.ptr(roi.y - box_rect.y + y) + (roi.x - box_rect.x),
+                   roi.width, bias);
+    }
   }
 }
 
@@ -149,8 +344,21 @@ void ImageProcess::ProcessOBBImage(
   }
 }
 
-void ImageProcess::ProcessTrackImage(cv::Mat &image,
-                                     object_detect_result_list &od_results) {
+// 标签和跟踪id的字形在第一次绘制时栅格化，所有视频流共用
+// 第一次绘制一定在推理之后，此时类别名已经加载
+static const LabelRenderer &GetLabelRenderer() {
+  static LabelRenderer renderer(cv::FONT_HERSHEY_COMPLEX, 1, 2, true);
+  return renderer;
+}
+
+static const LabelRenderer &GetTrackIdRenderer() {
+  static LabelRenderer renderer(cv::FONT_HERSHEY_SIMPLEX, 0.6, 2, false);
+  return renderer;
+}
+
+void ImageProcess::ProcessTrackImage(cv::Mat *image,
+                                     object_detect_result_list &od_results,
+                                     BYTETracker &tracker) const {
   std::vector<Object> objects;
   for (int i = 0; i < od_results.count; ++i) {
     object_detect_result *detect_result = &(od_results.results[i]);
@@ -167,20 +375,28 @@ void ImageProcess::ProcessTrackImage(cv::Mat &image,
     object.prob = detect_result->prop;
     objects.push_back(object);
   }
-  tracker_mutex_.lock();
-  std::vector<STrack> output_stracks = tracker_->update(objects);
+  std::vector<STrack> output_stracks = tracker.update(objects);
+  if (image == nullptr) {
+    return;
+  }
+  // 跟踪器工作在原图坐标，绘制时换算到图像的大小
+  float scale_x = static_cast<float>(image->cols) / width_;
+  float scale_y = static_cast<float>(image->rows) / height_;
   for (size_t i = 0; i < output_stracks.size(); ++i) {
     std::vector<float> tlwh = output_stracks[i].tlwh;
     bool vertical = tlwh[2] / tlwh[3] > 1.6;
     if (tlwh[2] * tlwh[3] > 20 && !vertical) {
-      Scalar s = tracker_->get_color(output_stracks[i].track_id);
-      putText(image, format("%d", output_stracks[i].track_id),
-              Point(tlwh[0], tlwh[1] - 5), 0, 0.6, Scalar(0, 0, 255), 2,
-              LINE_AA);
-      rectangle(image, Rect(tlwh[0], tlwh[1], tlwh[2], tlwh[3]), s, 2);
+      tlwh[0] *= scale_x;
+      tlwh[1] *= scale_y;
+      tlwh[2] *= scale_x;
+      tlwh[3] *= scale_y;
+      Scalar s = tracker.get_color(output_stracks[i].track_id);
+      GetTrackIdRenderer().DrawNumber(*image, output_stracks[i].track_id,
+                                      Point(tlwh[0], tlwh[1] - 5),
+                                      Scalar(0, 0, 255));
+      draw_box(*image, Rect(tlwh[0], tlwh[1], tlwh[2], tlwh[3]), s, 2);
     }
   }
-  tracker_mutex_.unlock();
 }
 
 void ImageProcess::ProcessDetectionImage(
@@ -194,32 +410,39 @@ void ImageProcess::ProcessDetectionImage(
                        detect_result->box.left, detect_result->box.top,
                        detect_result->box.right, detect_result->box.bottom,
                        detect_result->prop);
-    cv::rectangle(
-        image, cv::Point(detect_result->box.left, detect_result->box.top),
-        cv::Point(detect_result->box.right, detect_result->box.bottom),
-        cv::Scalar(0, 0, 255), 2);
-    char text[256];
-    sprintf(text, "%s %.1f%%", coco_cls_to_name(detect_result->cls_id),
-            detect_result->prop * 100);
-    cv::putText(image, text,
-                cv::Point(detect_result->box.left, detect_result->box.top + 20),
-                cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 0, 0), 2,
-                cv::LINE_8);
+    draw_box(image,
+             cv::Rect(detect_result->box.left, detect_result->box.top,
+                      detect_result->box.right - detect_result->box.left,
+                      detect_result->box.bottom - detect_result->box.top),
+             cv::Scalar(0, 0, 255), 2);
+    GetLabelRenderer().DrawLabel(
+        image, detect_result->cls_id, detect_result->prop,
+        cv::Point(detect_result->box.left, detect_result->box.top + 20),
+        cv::Scalar(255, 0, 0));
   }
 }
 
-void drawSkeleton(cv::Mat &img, const std::vector<cv::Point> &points,
-                  const std::vector<int> &pairs, const cv::Scalar &color,
-                  int thickness) {
-  for (size_t i = 0; i < pairs.size(); i += 2) {
-    int index1 = pairs[i];
-    int index2 = pairs[i + 1];
-    if (points[index1].x != -1 && points[index1].y != -1 &&
-        points[index2].x != -1 && points[index2].y != -1) {
-      cv::line(img, points[index1], points[index2], color, thickness);
-    }
-  }
-}
+// 17个关键点的骨架连线
+static const int kSkeleton[][2] = {
+    {0, 1},    // Nose to left eye
+    {1, 3},    // Left eye to left ear
+    {0, 2},    // Nose to right eye
+    {2, 4},    // Right eye to right ear
+    {0, 5},    // Nose to left shoulder
+    {5, 7},    // Left shoulder to left elbow
+    {7, 9},    // Left elbow to left wrist
+    {0, 6},    // Nose to right shoulder
+    {6, 8},    // Right shoulder to right elbow
+    {8, 10},   // Right elbow to right wrist
+    {5, 6},    // Left shoulder to right shoulder
+    {11, 12},  // Left hip to right hip
+    {11, 5},   // Left hip to left shoulder
+    {12, 6},   // Right hip to right shoulder
+    {11, 13},  // Left hip to left knee
+    {12, 14},  // Right hip to right knee
+    {13, 15},  // Left knee to left ankle
+    {14, 16}   // Right knee to right ankle
+};
 
 void ImageProcess::ProcessPoseImage(
     cv::Mat &image, object_detect_result_list &od_results) const {
@@ -229,42 +452,26 @@ void ImageProcess::ProcessPoseImage(
     KAYLORDUT_LOG_INFO("({} {} {} {}) {}", detect_result->box.left,
                        detect_result->box.top, detect_result->box.right,
                        detect_result->box.bottom, detect_result->prop);
-    cv::rectangle(
-        image, cv::Point(detect_result->box.left, detect_result->box.top),
-        cv::Point(detect_result->box.right, detect_result->box.bottom),
-        cv::Scalar(0, 0, 255), 2);
-    std::vector<cv::Point> points(17);
+    draw_box(image,
+             cv::Rect(detect_result->box.left, detect_result->box.top,
+                      detect_result->box.right - detect_result->box.left,
+                      detect_result->box.bottom - detect_result->box.top),
+             cv::Scalar(0, 0, 255), 2);
+    const auto &pose = od_results.results_pose[i];
     for (int j = 0; j < 17; ++j) {
-      if (od_results.results_pose[i].visibility[j] <= 0.6) {
-        points.at(j) = cv::Point(-1, -1);
+      if (pose.visibility[j] > 0.6) {
+        cv::circle(image, cv::Point(pose.kpt[j * 2 + 0], pose.kpt[j * 2 + 1]),
+                   10, cv::Scalar(0, 0, 255), cv::FILLED, cv::LINE_AA);
+      }
+    }
+    for (const auto &pair : kSkeleton) {
+      if (pose.visibility[pair[0]] <= 0.6 || pose.visibility[pair[1]] <= 0.6) {
         continue;
       }
-      points.at(j) = (cv::Point(od_results.results_pose[i].kpt[j * 2 + 0],
-                                od_results.results_pose[i].kpt[j * 2 + 1]));
-      cv::Point p(od_results.results_pose[i].kpt[j * 2 + 0],
-                  od_results.results_pose[i].kpt[j * 2 + 1]);
-      cv::circle(image, p, 10, cv::Scalar(0, 0, 255), cv::FILLED, cv::LINE_AA);
+      cv::line(image,
+               cv::Point(pose.kpt[pair[0] * 2 + 0], pose.kpt[pair[0] * 2 + 1]),
+               cv::Point(pose.kpt[pair[1] * 2 + 0], pose.kpt[pair[1] * 2 + 1]),
+               cv::Scalar(255, 0, 0), 2);
     }
-    std::vector<int> pairs = {
-        0,  1,   // Nose to left eye
-        1,  3,   // Left eye to left ear
-        0,  2,   // Nose to right eye
-        2,  4,   // Right eye to right ear
-        0,  5,   // Nose to left shoulder
-        5,  7,   // Left shoulder to left elbow
-        7,  9,   // Left elbow to left wrist
-        0,  6,   // Nose to right shoulder
-        6,  8,   // Right shoulder to right elbow
-        8,  10,  // Right elbow to right wrist
-        5,  6,   // Left shoulder to right shoulder
-        11, 12,  // Left hip to right hip
-        11, 5,   // Left hip to left shoulder
-        12, 6,   // Right hip to right shoulder
-        11, 13,  // Left hip to left knee
-        12, 14,  // Right hip to right knee
-        13, 15,  // Left knee to left ankle
-        14, 16   // Right knee to right ankle
-    };
-    drawSkeleton(image, points, pairs, cv::Scalar(255, 0, 0), 2);
   }
 }
@@ -0,0 +1,66 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "jpeg_decoder.h"
+
+#include "frame_pool.h"
+#include "kaylordut/log/logger.h"
+
+JpegDecoder::JpegDecoder() : handle_(tjInitDecompress()) {
+  if (handle_ == nullptr) {
+    KAYLORDUT_LOG_ERROR("tjInitDecompress failed");
+  }
+}
+
+JpegDecoder::~JpegDecoder() {
+  if (handle_ != nullptr) {
+    tjDestroy(handle_);
+  }
+}
+
+bool JpegDecoder::ReadHeader(const uint8_t *data, size_t size, int *width,
+                             int *height) {
+  int subsamp, colorspace;
+  if (handle_ == nullptr ||
+      tjDecompressHeader3(handle_, data, size, width, height, &subsamp,
+                          &colorspace) != 0) {
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<cv::Mat> JpegDecoder::Decode(const uint8_t *data, size_t size,
+                                             cv::Size min_size) {
+  int width, height;
+  if (!ReadHeader(data, size, &width, &height)) {
+    KAYLORDUT_LOG_ERROR("Read jpeg header failed: {}",
+                        handle_ == nullptr ? "no handle"
+                                           : tjGetErrorStr2(handle_));
+    return nullptr;
+  }
+  int scaled_width = width;
+  int scaled_height = height;
+  int num_factors = 0;
+  tjscalingfactor *factors = tjGetScalingFactors(&num_factors);
+  for (int i = 0; i < num_factors; ++i) {
+    // 只缩小不放大，并且不能小于letterbox需要的大小
+    if (factors[i].num > factors[i].denom) {
+      continue;
+    }
+    int w = TJSCALED(width, factors[i]);
+    int h = TJSCALED(height, factors[i]);
+    if (w >= min_size.width && h >= min_size.height && w < scaled_width) {
+      scaled_width = w;
+      scaled_height = h;
+    }
+  }
+  auto image =
+      FramePool::GetInstance().Acquire(scaled_height, scaled_width, CV_8UC3);
+  if (tjDecompress2(handle_, data, size, image->data, scaled_width, 0,
+                    scaled_height, TJPF_BGR, TJFLAG_FASTDCT) != 0) {
+    KAYLORDUT_LOG_ERROR("Decode jpeg failed: {}", tjGetErrorStr2(handle_));
+    return nullptr;
+  }
+  return image;
+}
@@ -0,0 +1,135 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "label_renderer.h"
+
+#include "postprocess.h"
+
+// 分数和id需要的字符
+static const std::string kCharset = "0123456789.%";
+
+// 非负整数转成十进制字符，返回长度，不添加结尾的'\0'
+static int FormatNumber(int value, char *text) {
+  char digits[12];
+  int count = 0;
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  for (int i = 0; i < count; ++i) {
+    text[i] = digits[count - 1 - i];
+  }
+  return count;
+}
+
+LabelRenderer::LabelRenderer(int font_face, double font_scale, int thickness,
+                             bool with_class_names)
+    : font_face_(font_face), font_scale_(font_scale), thickness_(thickness) {
+  for (char c : kCharset) {
+    char_glyphs_.push_back(Rasterize(std::string(1, c)));
+  }
+  if (with_class_names) {
+    for (int i = 0; i < OBJ_CLASS_NUM; ++i) {
+      class_glyphs_.push_back(
+          Rasterize(std::string(coco_cls_to_name(i)) + " "));
+    }
+  }
+}
+
+LabelRenderer::Glyph LabelRenderer::Rasterize(const std::string &text) const {
+  int baseline = 0;
+  cv::Size size =
+      cv::getTextSize(text, font_face_, font_scale_, thickness_, &baseline);
+  // 四周留出线宽的余量，笔画不会被截断
+  Glyph glyph;
+  glyph.left = thickness_;
+  glyph.ascent = size.height + thickness_;
+  glyph.advance = size.width;
+  glyph.mask = cv::Mat::zeros(glyph.ascent + baseline + thickness_ * 2,
+                              size.width + thickness_ * 2, CV_8UC1);
+  cv::putText(glyph.mask, text, cv::Point(glyph.left, glyph.ascent),
+              font_face_, font_scale_, cv::Scalar(255), thickness_,
+              cv::LINE_8);
+  return glyph;
+}
+
+int LabelRenderer::Blit(cv::Mat &image, const Glyph &glyph, cv::Point origin,
+                        const cv::Scalar &color) const {
+  const uint8_t bgr[3] = {cv::saturate_cast<uint8_t>(color[0]),
+                          cv::saturate_cast<uint8_t>(color[1]),
+                          cv::saturate_cast<uint8_t>(color[2])};
+  int x0 = origin.x - glyph.left;
+  int y0 = origin.y - glyph.ascent;
+  // 只拷贝和图像相交的部分
+  int begin_x = std::max(0, -x0);
+  int end_x = std::min(glyph.mask.cols, image.cols - x0);
+  int begin_y = std::max(0, -y0);
+  int end_y = std::min(glyph.mask.rows, image.rows - y0);
+  for (int y = begin_y; y < end_y; ++y) {
+    const uint8_t *mask_row = glyph.mask.ptr(y);
+    uint8_t *pixel = image.ptr(y0 + y) + (x0 + begin_x) * 3;
+    for (int x = begin_x; x < end_x; ++x, pixel += 3) {
+      if (mask_row[x] != 0) {
+        pixel[0] = bgr[0];
+        pixel[1] = bgr[1];
+        pixel[2] = bgr[2];
+      }
+    }
+  }
+  return glyph.advance;
+}
+
+const LabelRenderer::Glyph *LabelRenderer::GetCharGlyph(char c) const {
+  auto pos = kCharset.find(c);
+  return pos == std::string::npos ? nullptr : &char_glyphs_[pos];
+}
+
+void LabelRenderer::DrawLabel(cv::Mat &image, int cls_id, float score,
+                              cv::Point origin,
+                              const cv::Scalar &color) const {
+  if (cls_id >= 0 && cls_id < static_cast<int>(class_glyphs_.size())) {
+    origin.x += Blit(image, class_glyphs_[cls_id], origin, color);
+  }
+  // 和"%.1f%%"相同：百分比保留一位小数
+  int tenths = static_cast<int>(std::lround(score * 1000.0f));
+  char text[16];
+  int length = FormatNumber(std::max(0, tenths / 10), text);
+  text[length++] = '.';
+  text[length++] = '0' + std::max(0, tenths % 10);
+  text[length++] = '%';
+  for (int i = 0; i < length; ++i) {
+    origin.x += Blit(image, *GetCharGlyph(text[i]), origin, color);
+  }
+}
+
+void LabelRenderer::DrawNumber(cv::Mat &image, int number, cv::Point origin,
+                               const cv::Scalar &color) const {
+  char text[12];
+  int length = FormatNumber(std::max(0, number), text);
+  for (int i = 0; i < length; ++i) {
+    origin.x += Blit(image, *GetCharGlyph(text[i]), origin, color);
+  }
+}
+
+void draw_box(cv::Mat &image, const cv::Rect &rect, const cv::Scalar &color,
+              int thickness) {
+  // 和cv::rectangle一样，线宽以边为中心
+  int half = thickness / 2;
+  int outer_x = rect.x - half;
+  int outer_y = rect.y - half;
+  int outer_w = rect.width + thickness;
+  int outer_h = rect.height + thickness;
+  const cv::Rect image_rect(0, 0, image.cols, image.rows);
+  const cv::Rect edges[4] = {
+      cv::Rect(outer_x, outer_y, outer_w, thickness),
+      cv::Rect(outer_x, outer_y + outer_h - thickness, outer_w, thickness),
+      cv::Rect(outer_x, outer_y, thickness, outer_h),
+      cv::Rect(outer_x + outer_w - thickness, outer_y, thickness, outer_h)};
+  for (const auto &edge : edges) {
+    cv::Rect roi = edge & image_rect;
+    if (!roi.empty()) {
+      image(roi).setTo(color);
+    }
+  }
+}
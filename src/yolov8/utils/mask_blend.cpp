@@ -0,0 +1,106 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "mask_blend.h"
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+void mask_color_bias(const uint8_t color[3], uint16_t bias[3]) {
+  for (int c = 0; c < 3; ++c) {
+    bias[c] = color[c] * (256 - kMaskWeight) + 128;
+  }
+}
+
+void blend_mask_row_scalar(uint8_t *pixel, const uint8_t *mask, int count,
+                           const uint16_t bias[3]) {
+  for (int x = 0; x < count; ++x) {
+    if (mask[x] == 0) {
+      continue;
+    }
+    uint8_t *p = pixel + x * 3;
+    for (int c = 0; c < 3; ++c) {
+      p[c] = static_cast<uint8_t>((p[c] * kMaskWeight + bias[c]) >> 8);
+    }
+  }
+}
+
+void blend_mask_row(uint8_t *pixel, const uint8_t *mask, int count,
+                    const uint16_t bias[3]) {
+  int x = 0;
+#if defined(__ARM_NEON)
+  // 一次处理16个像素，vld3按通道拆开
+  const uint8x8_t weight = vdup_n_u8(kMaskWeight);
+  const uint16x8_t bias_vec[3] = {vdupq_n_u16(bias[0]), vdupq_n_u16(bias[1]),
+                                  vdupq_n_u16(bias[2])};
+  for (; x + 16 <= count; x += 16) {
+    uint8x16_t select = vtstq_u8(vld1q_u8(mask + x), vld1q_u8(mask + x));
+    uint8x8_t any = vorr_u8(vget_low_u8(select), vget_high_u8(select));
+    if (vget_lane_u64(vreinterpret_u64_u8(any), 0) == 0) {
+      continue;
+    }
+    uint8x16x3_t bgr = vld3q_u8(pixel + x * 3);
+    for (int c = 0; c < 3; ++c) {
+      uint16x8_t low =
+          vmlal_u8(bias_vec[c], vget_low_u8(bgr.val[c]), weight);
+      uint16x8_t high =
+          vmlal_u8(bias_vec[c], vget_high_u8(bgr.val[c]), weight);
+      uint8x16_t blended =
+          vcombine_u8(vshrn_n_u16(low, 8), vshrn_n_u16(high, 8));
+      bgr.val[c] = vbslq_u8(select, blended, bgr.val[c]);
+    }
+    vst3q_u8(pixel + x * 3, bgr);
+  }
+#elif defined(__SSSE3__)
+  // 一次处理16个像素（48字节，3个向量），通道在向量里按BGR交错排列，
+  // 掩码按每个像素3个字节展开，颜色也按交错的顺序排列
+  const __m128i expand[3] = {
+      _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5),
+      _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10),
+      _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15,
+                    15, 15)};
+  __m128i bias_vec[3][2];
+  for (int v = 0; v < 3; ++v) {
+    for (int half = 0; half < 2; ++half) {
+      uint16_t lanes[8];
+      for (int j = 0; j < 8; ++j) {
+        lanes[j] = bias[(v * 16 + half * 8 + j) % 3];
+      }
+      bias_vec[v][half] = _mm_loadu_si128(reinterpret_cast<__m128i *>(lanes));
+    }
+  }
+  const __m128i weight = _mm_set1_epi16(kMaskWeight);
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 16 <= count; x += 16) {
+    __m128i select = _mm_xor_si128(
+        _mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + x)),
+            zero),
+        _mm_set1_epi8(-1));
+    if (_mm_movemask_epi8(select) == 0) {
+      continue;
+    }
+    __m128i *dst = reinterpret_cast<__m128i *>(pixel + x * 3);
+    for (int v = 0; v < 3; ++v) {
+      __m128i bgr = _mm_loadu_si128(dst + v);
+      __m128i low = _mm_add_epi16(
+          _mm_mullo_epi16(_mm_unpacklo_epi8(bgr, zero), weight),
+          bias_vec[v][0]);
+      __m128i high = _mm_add_epi16(
+          _mm_mullo_epi16(_mm_unpackhi_epi8(bgr, zero), weight),
+          bias_vec[v][1]);
+      __m128i blended = _mm_packus_epi16(_mm_srli_epi16(low, 8),
+                                         _mm_srli_epi16(high, 8));
+      __m128i pixel_select = _mm_shuffle_epi8(select, expand[v]);
+      bgr = _mm_or_si128(_mm_and_si128(pixel_select, blended),
+                         _mm_andnot_si128(pixel_select, bgr));
+      _mm_storeu_si128(dst + v, bgr);
+    }
+  }
+#endif
+  blend_mask_row_scalar(pixel + x * 3, mask + x, count - x, bias);
+}
+
@@ -0,0 +1,53 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "mask_encoding.h"
+
+std::vector<uint32_t> encode_mask_rle(const uint8_t *mask, int width,
+                                      int height) {
+  std::vector<uint32_t> counts;
+  if (mask == nullptr) {
+    return counts;
+  }
+  const int total = width * height;
+  uint8_t value = 0;
+  uint32_t run = 0;
+  for (int i = 0; i < total; ++i) {
+    uint8_t pixel = mask[i] != 0;
+    if (pixel != value) {
+      counts.push_back(run);
+      value = pixel;
+      run = 0;
+    }
+    run++;
+  }
+  counts.push_back(run);
+  return counts;
+}
+
+std::vector<std::vector<cv::Point>> encode_mask_polygons(
+    const uint8_t *mask, int width, int height, cv::Point offset,
+    double epsilon) {
+  std::vector<std::vector<cv::Point>> polygons;
+  if (mask == nullptr || width == 0 || height == 0) {
+    return polygons;
+  }
+  // findContours会修改输入，在副本上查找
+  cv::Mat binary = cv::Mat(height, width, CV_8UC1, (void *)mask).clone();
+  std::vector<std::vector<cv::Point>> contours;
+  cv::findContours(binary, contours, cv::RETR_EXTERNAL,
+                   cv::CHAIN_APPROX_SIMPLE, offset);
+  for (auto &contour : contours) {
+    if (epsilon > 0) {
+      std::vector<cv::Point> approx;
+      cv::approxPolyDP(contour, approx, epsilon, true);
+      contour = std::move(approx);
+    }
+    // 少于3个点的轮廓不是多边形
+    if (contour.size() >= 3) {
+      polygons.push_back(std::move(contour));
+    }
+  }
+  return polygons;
+}
@@ -0,0 +1,50 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "model_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "kaylordut/log/logger.h"
+
+ModelFile::ModelFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    KAYLORDUT_LOG_ERROR("open {} failed!", path);
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    KAYLORDUT_LOG_ERROR("stat {} failed!", path);
+    close(fd);
+    return;
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // 映射建立之后就不再需要文件描述符
+  close(fd);
+  if (data == MAP_FAILED) {
+    KAYLORDUT_LOG_ERROR("mmap {} failed!", path);
+    return;
+  }
+  // rknn_init会读取整个模型，提示内核提前预读
+  madvise(data, st.st_size, MADV_WILLNEED);
+  data_ = data;
+  size_ = st.st_size;
+  KAYLORDUT_LOG_INFO("map model {}, size = {} bytes", path, size_);
+}
+
+ModelFile::~ModelFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+bool ModelFile::IsValid() const { return data_ != nullptr; }
+
+void *ModelFile::get_data() const { return data_; }
+
+size_t ModelFile::get_size() const { return size_; }
@@ -0,0 +1,74 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "npu_scheduler.h"
+
+#include "kaylordut/log/logger.h"
+
+// 新的耗时在平均值中所占的权重
+static const double kRunTimeWeight = 0.2;
+
+NpuScheduler::NpuScheduler(int context_num, int max_in_flight)
+    : loads_(context_num), max_in_flight_(max_in_flight) {}
+
+int NpuScheduler::SelectContext() const {
+  int selected = -1;
+  double selected_cost = 0.0;
+  int context_num = loads_.size();
+  for (int k = 0; k < context_num; ++k) {
+    int i = (next_ + k) % context_num;
+    const ContextLoad &load = loads_[i];
+    if (load.in_flight >= max_in_flight_) {
+      continue;
+    }
+    // 预计完成时间：排在前面的任务加上本次任务
+    double cost = (load.in_flight + 1) * load.average_us;
+    if (selected == -1 || cost < selected_cost) {
+      selected = i;
+      selected_cost = cost;
+    }
+  }
+  return selected;
+}
+
+int NpuScheduler::Acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  int context_id = -1;
+  condition_.wait(lock, [&] {
+    context_id = SelectContext();
+    return context_id != -1;
+  });
+  loads_[context_id].in_flight++;
+  next_ = (context_id + 1) % loads_.size();
+  return context_id;
+}
+
+void NpuScheduler::Release(int context_id,
+                           std::chrono::microseconds run_time) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ContextLoad &load = loads_[context_id];
+    load.in_flight--;
+    if (load.runs == 0) {
+      load.average_us = run_time.count();
+    } else {
+      load.average_us = load.average_us * (1.0 - kRunTimeWeight) +
+                        run_time.count() * kRunTimeWeight;
+    }
+    load.runs++;
+    KAYLORDUT_LOG_DEBUG("context {} run time is {}us, average is {}us",
+                        context_id, run_time.count(), load.average_us);
+  }
+  condition_.notify_one();
+}
+
+int NpuScheduler::get_in_flight(int context_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return loads_[context_id].in_flight;
+}
+
+double NpuScheduler::get_average_run_time_ms(int context_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return loads_[context_id].average_us / 1000.0;
+}
@@ -4,14 +4,17 @@
 
 #include "postprocess.h"
 
+#include <algorithm>
+#include <functional>
 #include <set>
 
 #include "Float16.h"
+#include "cmath"
 #include "filesystem"
 #include "kaylordut/log/logger.h"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/opencv.hpp"
-#include "rknn_matmul_api.h"
+#include "threadpool.h"
 static char *labels[OBJ_CLASS_NUM];
 static int num_labels = 0;
 int clamp(float val, int min, int max) {
@@ -240,231 +243,160 @@ static int nms(int validCount, std::vector<float> &bboxes,
   return 0;
 }
 
-static void crop_mask(uint8_t *seg_mask, uint8_t *all_mask_in_one, float *boxes,
-                      int boxes_num, int *cls_id, int height, int width) {
-  for (int b = 0; b < boxes_num; b++) {
-    float x1 = boxes[b * 4 + 0];
-    float y1 = boxes[b * 4 + 1];
-    float x2 = boxes[b * 4 + 2];
-    float y2 = boxes[b * 4 + 3];
-
-    for (int i = 0; i < height; i++) {
-      for (int j = 0; j < width; j++) {
-        // 判断该点在矩形框内
-        if (j >= x1 && j < x2 && i >= y1 && i < y2) {
-          if (all_mask_in_one[i * width + j] == 0) {
-            // seg_mask只有 0或者1 ， cls_id因为可能存在0值，所以 +1
-            // 避免结果都为0
-            all_mask_in_one[i * width + j] =
-                seg_mask[b * width * height + i * width + j] * (cls_id[b] + 1);
-          }
-        }
-      }
-    }
-  }
+// 输出张量中第channel个通道、第cell个网格单元的下标
+static inline int layout_offset(const tensor_layout_t &layout, int cell,
+                                int channel) {
+  return (channel / layout.c2) * layout.plane * layout.c2 + cell * layout.c2 +
+         channel % layout.c2;
 }
 
-static void matmul_by_npu_i8(std::vector<float> &A_input, float *B_input,
-                             uint8_t *C_input, int ROWS_A, int COLS_A,
-                             int COLS_B, rknn_app_context_t *app_ctx) {
-  int B_layout = 0;
-  int AC_layout = 0;
-  int32_t M = 1;
-  int32_t K = COLS_A;
-  int32_t N = COLS_B;
-
-  rknn_matmul_ctx ctx;
-  rknn_matmul_info info;
-  memset(&info, 0, sizeof(rknn_matmul_info));
-  info.M = M;
-  info.K = K;
-  info.N = N;
-  info.type = RKNN_INT8_MM_INT8_TO_INT32;
-  info.B_layout = B_layout;
-  info.AC_layout = AC_layout;
-
-  rknn_matmul_io_attr io_attr;
-  memset(&io_attr, 0, sizeof(rknn_matmul_io_attr));
-
-  int8_t int8Vector_A[ROWS_A * COLS_A];
-  for (int i = 0; i < ROWS_A * COLS_A; ++i) {
-    int8Vector_A[i] = (int8_t)A_input[i];
-  }
-
-  int8_t int8Vector_B[COLS_A * COLS_B];
-  for (int i = 0; i < COLS_A * COLS_B; ++i) {
-    int8Vector_B[i] = (int8_t)B_input[i];
-  }
+// 检测框在原型平面上覆盖的单元，向外多取一个单元供双线性插值使用
+static cv::Rect proto_roi(const image_rect_t &box,
+                          const letterbox_t *letter_box, float proto_stride,
+                          int proto_height, int proto_width) {
+  int x0 = (int)std::floor(
+               (box.left * letter_box->scale + letter_box->x_pad) /
+               proto_stride) -
+           1;
+  int y0 = (int)std::floor(
+               (box.top * letter_box->scale + letter_box->y_pad) /
+               proto_stride) -
+           1;
+  int x1 = (int)std::ceil(
+               (box.right * letter_box->scale + letter_box->x_pad) /
+               proto_stride) +
+           1;
+  int y1 = (int)std::ceil(
+               (box.bottom * letter_box->scale + letter_box->y_pad) /
+               proto_stride) +
+           1;
+  x0 = std::max(0, x0);
+  y0 = std::max(0, y0);
+  x1 = std::min(proto_width, x1);
+  y1 = std::min(proto_height, y1);
+  return cv::Rect(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
+}
 
-  int ret = rknn_matmul_create(&ctx, &info, &io_attr);
-  // Create A
-  rknn_tensor_mem *A = rknn_create_mem(ctx, io_attr.A.size);
-  // Create B
-  rknn_tensor_mem *B = rknn_create_mem(ctx, io_attr.B.size);
-  // Create C
-  rknn_tensor_mem *C = rknn_create_mem(ctx, io_attr.C.size);
-
-  memcpy(B->virt_addr, int8Vector_B, B->size);
-  // Set A
-  ret = rknn_matmul_set_io_mem(ctx, A, &io_attr.A);
-  // Set B
-  ret = rknn_matmul_set_io_mem(ctx, B, &io_attr.B);
-  // Set C
-  ret = rknn_matmul_set_io_mem(ctx, C, &io_attr.C);
-
-  for (int i = 0; i < ROWS_A; ++i) {
-    memcpy(A->virt_addr, int8Vector_A + i * A->size, A->size);
-
-    // Run
-    ret = rknn_matmul_run(ctx);
-
-    for (int j = 0; j < COLS_B; ++j) {
-      if (((int32_t *)C->virt_addr)[j] > 0) {
-        C_input[i * COLS_B + j] = 1;
-      } else {
-        C_input[i * COLS_B + j] = 0;
+// 原型（proto）输出，按实际的内存布局直接读取，不复制成NCHW
+typedef struct {
+  const void *data;
+  tensor_layout_t layout;
+  int width;
+  int height;
+  bool is_quant;
+  bool is_fp16;
+  int32_t zp;
+} proto_tensor_t;
+
+// 按通道累加：convert_row把roi内的一行（同一通道的相邻单元在内存中间隔c2个
+// 元素，NCHW时是连续的）转换成fp32，乘加的内层循环是连续的，可以向量化
+template <typename T, typename ConvertRow>
+static void accumulate_proto(const T *tensor, const proto_tensor_t &proto,
+                             const float *coefficients, const cv::Rect &roi,
+                             ConvertRow convert_row, float *sum) {
+  std::vector<float> row(roi.width);
+  for (int k = 0; k < PROTO_CHANNEL; ++k) {
+    const float coefficient = coefficients[k];
+    for (int y = 0; y < roi.height; ++y) {
+      const T *src = tensor + layout_offset(proto.layout,
+                                            (roi.y + y) * proto.width + roi.x,
+                                            k);
+      convert_row(src, proto.layout.c2, roi.width, row.data());
+      float *acc = sum + y * roi.width;
+      for (int x = 0; x < roi.width; ++x) {
+        acc[x] += coefficient * row[x];
       }
     }
   }
-
-  // destroy
-  rknn_destroy_mem(ctx, A);
-  rknn_destroy_mem(ctx, B);
-  rknn_destroy_mem(ctx, C);
-  rknn_matmul_destroy(ctx);
 }
 
-static void matmul_by_npu_fp16(std::vector<float> &A_input, float *B_input,
-                               uint8_t *C_input, int ROWS_A, int COLS_A,
-                               int COLS_B, rknn_app_context_t *app_ctx) {
-  int B_layout = 0;
-  int AC_layout = 0;
-  int32_t M = ROWS_A;
-  int32_t K = COLS_A;
-  int32_t N = COLS_B;
-
-  rknn_matmul_ctx ctx;
-  rknn_matmul_info info;
-  memset(&info, 0, sizeof(rknn_matmul_info));
-  info.M = M;
-  info.K = K;
-  info.N = N;
-  info.type = RKNN_FLOAT16_MM_FLOAT16_TO_FLOAT32;
-  info.B_layout = B_layout;
-  info.AC_layout = AC_layout;
-
-  rknn_matmul_io_attr io_attr;
-  memset(&io_attr, 0, sizeof(rknn_matmul_io_attr));
-
-  rknpu2::float16 int8Vector_A[ROWS_A * COLS_A];
-  for (int i = 0; i < ROWS_A * COLS_A; ++i) {
-    int8Vector_A[i] = (rknpu2::float16)A_input[i];
+// 掩码系数和原型相乘，只读取和计算roi内的单元，结果大于0的为1
+// 量化模型只减去零点，不乘scale：掩码只关心点乘之后的符号
+static void proto_mask(const float *coefficients, const proto_tensor_t &proto,
+                       const cv::Rect &roi, uint8_t *dst) {
+  std::vector<float> sum(roi.width * roi.height, 0.0f);
+  if (proto.is_quant) {
+    const int32_t zp = proto.zp;
+    accumulate_proto(
+        static_cast<const int8_t *>(proto.data), proto, coefficients, roi,
+        [zp](const int8_t *src, int stride, int count, float *row) {
+          for (int x = 0; x < count; ++x) {
+            row[x] = src[x * stride] - zp;
+          }
+        },
+        sum.data());
+  } else if (proto.is_fp16) {
+    accumulate_proto(
+        static_cast<const uint16_t *>(proto.data), proto, coefficients, roi,
+        [](const uint16_t *src, int stride, int count, float *row) {
+          if (stride == 1) {
+            rknpu2::to_fp32(src, row, count);
+            return;
+          }
+          for (int x = 0; x < count; ++x) {
+            row[x] = rknpu2::to_fp32(src[x * stride]);
+          }
+        },
+        sum.data());
+  } else {
+    accumulate_proto(
+        static_cast<const float *>(proto.data), proto, coefficients, roi,
+        [](const float *src, int stride, int count, float *row) {
+          for (int x = 0; x < count; ++x) {
+            row[x] = src[x * stride];
+          }
+        },
+        sum.data());
   }
-
-  rknpu2::float16 int8Vector_B[COLS_A * COLS_B];
-  for (int i = 0; i < COLS_A * COLS_B; ++i) {
-    int8Vector_B[i] = (rknpu2::float16)B_input[i];
+  for (size_t i = 0; i < sum.size(); ++i) {
+    dst[i] = sum[i] > 0 ? 1 : 0;
   }
-
-  int ret = rknn_matmul_create(&ctx, &info, &io_attr);
-  // Create A
-  rknn_tensor_mem *A = rknn_create_mem(ctx, io_attr.A.size);
-  // Create B
-  rknn_tensor_mem *B = rknn_create_mem(ctx, io_attr.B.size);
-  // Create C
-  rknn_tensor_mem *C = rknn_create_mem(ctx, io_attr.C.size);
-
-  memcpy(A->virt_addr, int8Vector_A, A->size);
-  memcpy(B->virt_addr, int8Vector_B, B->size);
-
-  // Set A
-  ret = rknn_matmul_set_io_mem(ctx, A, &io_attr.A);
-  // Set B
-  ret = rknn_matmul_set_io_mem(ctx, B, &io_attr.B);
-  // Set C
-  ret = rknn_matmul_set_io_mem(ctx, C, &io_attr.C);
-
-  // Run
-  ret = rknn_matmul_run(ctx);
-  for (int i = 0; i < ROWS_A * COLS_B; ++i) {
-    if (((float *)C->virt_addr)[i] > 0) {
-      C_input[i] = 1;
-    } else {
-      C_input[i] = 0;
-    }
-  }
-
-  // destroy
-  rknn_destroy_mem(ctx, A);
-  rknn_destroy_mem(ctx, B);
-  rknn_destroy_mem(ctx, C);
-  rknn_matmul_destroy(ctx);
-}
-static void resize_by_opencv(uint8_t *input_image, int input_width,
-                             int input_height, uint8_t *output_image,
-                             int target_width, int target_height) {
-  cv::Mat src_image(input_height, input_width, CV_8U, input_image);
-  cv::Mat dst_image;
-  cv::resize(src_image, dst_image, cv::Size(target_width, target_height), 0, 0,
-             cv::INTER_LINEAR);
-  memcpy(output_image, dst_image.data, target_width * target_height);
 }
 
-static void seg_reverse(uint8_t *seg_mask, uint8_t *cropped_seg,
-                        uint8_t *seg_mask_real, int model_in_height,
-                        int model_in_width, int proto_height, int proto_width,
-                        int cropped_height, int cropped_width,
-                        int ori_in_height, int ori_in_width, int y_pad,
-                        int x_pad) {
-  int cropped_index = 0;
-  for (int i = 0; i < proto_height; i++) {
-    for (int j = 0; j < proto_width; j++) {
-      if (i >= y_pad && i < proto_height - y_pad && j >= x_pad &&
-          j < proto_width - x_pad) {
-        int seg_index = i * proto_width + j;
-        cropped_seg[cropped_index] = seg_mask[seg_index];
-        cropped_index++;
-      }
-    }
+// 计算一个实例在检测框内的掩码：先在原型平面上只计算检测框覆盖的单元，
+// 再由一次仿射变换完成裁剪和缩放，得到原图分辨率的掩码
+// 按像素中心对齐：原图 -> 模型输入（letterbox） -> 原型掩码
+static void instance_mask(const float *coefficients,
+                          const proto_tensor_t &proto, float proto_stride,
+                          const image_rect_t &box,
+                          const letterbox_t *letter_box,
+                          object_segment_result *seg_result) {
+  seg_result->width = std::max(0, box.right - box.left);
+  seg_result->height = std::max(0, box.bottom - box.top);
+  cv::Rect roi = proto_roi(box, letter_box, proto_stride, proto.height,
+                           proto.width);
+  if (seg_result->width == 0 || seg_result->height == 0 || roi.empty()) {
+    seg_result->seg_mask = nullptr;
+    return;
   }
-
-  // Note: Here are different methods provided for implementing single-channel
-  // image scaling
-  resize_by_opencv(cropped_seg, cropped_width, cropped_height, seg_mask_real,
-                   ori_in_width, ori_in_height);
-  // resize_by_rga_rk356x(cropped_seg, cropped_width, cropped_height,
-  // seg_mask_real, ori_in_width, ori_in_height);
-  // resize_by_rga_rk3588(cropped_seg, cropped_width, cropped_height,
-  // seg_mask_real, ori_in_width, ori_in_height);
+  std::vector<uint8_t> roi_mask(roi.width * roi.height);
+  proto_mask(coefficients, proto, roi, roi_mask.data());
+  seg_result->seg_mask =
+      (uint8_t *)malloc(seg_result->width * seg_result->height);
+  cv::Mat src(roi.height, roi.width, CV_8UC1, roi_mask.data());
+  cv::Mat dst(seg_result->height, seg_result->width, CV_8UC1,
+              seg_result->seg_mask);
+  double ratio = letter_box->scale / proto_stride;
+  cv::Matx23d transform(
+      ratio, 0,
+      ((box.left + 0.5) * letter_box->scale + letter_box->x_pad) /
+              proto_stride -
+          0.5 - roi.x,
+      0, ratio,
+      ((box.top + 0.5) * letter_box->scale + letter_box->y_pad) /
+              proto_stride -
+          0.5 - roi.y);
+  // 掩码只有0和1，双线性插值之后四舍五入，相当于以0.5为阈值
+  cv::warpAffine(src, dst, transform, dst.size(),
+                 cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT,
+                 cv::Scalar(0));
 }
 
-static int quick_sort_indice_inverse(std::vector<float> &input, int left,
-                                     int right, std::vector<int> &indices) {
-  float key;
-  int key_index;
-  int low = left;
-  int high = right;
-  if (left < right) {
-    key_index = indices[left];
-    key = input[left];
-    while (low < high) {
-      while (low < high && input[high] <= key) {
-        high--;
-      }
-      input[low] = input[high];
-      indices[low] = indices[high];
-      while (low < high && input[low] >= key) {
-        low++;
-      }
-      input[high] = input[low];
-      indices[high] = indices[low];
-    }
-    input[low] = key;
-    indices[low] = key_index;
-    quick_sort_indice_inverse(input, left, low - 1, indices);
-    quick_sort_indice_inverse(input, low + 1, right, indices);
+void release_seg_masks(object_detect_result_list *od_results) {
+  for (int i = 0; i < OBJ_NUMB_MAX_SIZE; ++i) {
+    free(od_results->results_seg[i].seg_mask);
+    od_results->results_seg[i].seg_mask = nullptr;
   }
-  return low;
 }
 
 inline static int32_t __clip(float val, float min, float max) {
@@ -503,212 +435,324 @@ void compute_dfl(float *tensor, int dfl_len, float *box) {
   }
 }
 
-static int process_i8(rknn_output *all_input, int input_id, int grid_h,
-                      int grid_w, int height, int width, int stride,
-                      int dfl_len, std::vector<float> &boxes,
-                      std::vector<float> &segments, float *proto,
-                      std::vector<float> &objProbs, std::vector<int> &classId,
-                      float threshold, rknn_app_context_t *app_ctx) {
-  int validCount = 0;
-  // 这个张量的H*W，用来记录每一个通道占用内存的长度
-  int grid_len = grid_h * grid_w;
-
-  // Skip if input_id is not 0, 4, 8, or 12
-  if (input_id % 4 != 0) {
-    return validCount;
-  }
-  // 最后的这一层是跟掩膜相关，处理方式与其他不一样
-  if (input_id == 12) {
-    /**
-     * 获取第12层的输出数据，然后把量化后的数据还原到为原来的浮点型
-     * 需要注意的是，这里没有使用比例关系，因为程序需要是INT的数据，不需要0~1的float数据
-     */
-    int8_t *input_proto = (int8_t *)all_input[input_id].buf;
-    int32_t zp_proto = app_ctx->output_attrs[input_id].zp;
-    for (int i = 0; i < PROTO_CHANNEL * PROTO_HEIGHT * PROTO_WEIGHT; i++) {
-      proto[i] = input_proto[i] - zp_proto;
-    }
-    return validCount;
-  }
-
-  int8_t *box_tensor = (int8_t *)all_input[input_id].buf;
-  int32_t box_zp = app_ctx->output_attrs[input_id].zp;
-  float box_scale = app_ctx->output_attrs[input_id].scale;
-
-  int8_t *score_tensor = (int8_t *)all_input[input_id + 1].buf;
-  int32_t score_zp = app_ctx->output_attrs[input_id + 1].zp;
-  float score_scale = app_ctx->output_attrs[input_id + 1].scale;
-
-  int8_t *score_sum_tensor = nullptr;
-  int32_t score_sum_zp = 0;
-  float score_sum_scale = 1.0;
-  score_sum_tensor = (int8_t *)all_input[input_id + 2].buf;
-  score_sum_zp = app_ctx->output_attrs[input_id + 2].zp;
-  score_sum_scale = app_ctx->output_attrs[input_id + 2].scale;
-
-  int8_t *seg_tensor = (int8_t *)all_input[input_id + 3].buf;
-  int32_t seg_zp = app_ctx->output_attrs[input_id + 3].zp;
-  float seg_scale = app_ctx->output_attrs[input_id + 3].scale;
-  // 计算得分阈值的量化之后的数值
+// 第一阶段的候选：只记录分数、类别和所在的输出分支、网格单元
+// 框（DFL）在选出分数最高的top_k个候选之后才解码
+typedef struct {
+  float score;
+  int cls_id;
+  int branch;
+  int cell;
+} candidate_t;
+
+// 在[cell_begin, cell_end)的网格单元中取分数最大的类别，超过阈值的加入候选
+// score_sum_tensor不为空时先用类别分数之和快速过滤，它只有一个通道，
+// 第cell个网格单元在cell * score_sum_c2
+// 类别按c2分块遍历，块内连续，不需要在循环里做除法
+static void collect_candidates_i8(const int8_t *score_tensor, int32_t score_zp,
+                                  float score_scale,
+                                  const int8_t *score_sum_tensor,
+                                  int32_t score_sum_zp, float score_sum_scale,
+                                  int score_sum_c2, int class_num,
+                                  const tensor_layout_t &layout, int branch,
+                                  int cell_begin, int cell_end,
+                                  float threshold,
+                                  std::vector<candidate_t> &candidates) {
   int8_t score_thres_i8 = qnt_f32_to_affine(threshold, score_zp, score_scale);
   int8_t score_sum_thres_i8 =
       qnt_f32_to_affine(threshold, score_sum_zp, score_sum_scale);
-
-  for (int i = 0; i < grid_h; i++) {
-    for (int j = 0; j < grid_w; j++) {
-      int offset = i * grid_w + j;
-      int max_class_id = -1;
-
-      int offset_seg = i * grid_w + j;
-      int8_t *in_ptr_seg = seg_tensor + offset_seg;
-
-      // for quick filtering through "score sum"
-      if (score_sum_tensor != nullptr) {
-        // 如果得分总和少于设定阈值，直接放弃本次的目标
-        if (score_sum_tensor[offset] < score_sum_thres_i8) {
-          continue;
+  int block_len = layout.plane * layout.c2;
+  for (int cell = cell_begin; cell < cell_end; cell++) {
+    if (score_sum_tensor != nullptr &&
+        score_sum_tensor[cell * score_sum_c2] < score_sum_thres_i8) {
+      continue;
+    }
+    int max_class_id = -1;
+    int8_t max_score = -score_zp;
+    const int8_t *block = score_tensor + cell * layout.c2;
+    for (int c = 0; c < class_num; block += block_len) {
+      for (int k = 0; k < layout.c2 && c < class_num; k++, c++) {
+        if ((block[k] > score_thres_i8) && (block[k] > max_score)) {
+          max_score = block[k];
+          max_class_id = c;
         }
       }
+    }
+    if (max_score > score_thres_i8) {
+      candidates.push_back(
+          {deqnt_affine_to_f32(max_score, score_zp, score_scale), max_class_id,
+           branch, cell});
+    }
+  }
+}
 
-      int8_t max_score = -score_zp;
-      for (int c = 0; c < num_labels; c++) {  // 这里是为了保留最大的概率类别
-        if ((score_tensor[offset] > score_thres_i8) &&
-            (score_tensor[offset] > max_score)) {
-          max_score = score_tensor[offset];
+static void collect_candidates_fp32(const float *score_tensor,
+                                    const float *score_sum_tensor,
+                                    int score_sum_c2, int class_num,
+                                    const tensor_layout_t &layout, int branch,
+                                    int cell_begin, int cell_end,
+                                    float threshold,
+                                    std::vector<candidate_t> &candidates) {
+  int block_len = layout.plane * layout.c2;
+  for (int cell = cell_begin; cell < cell_end; cell++) {
+    if (score_sum_tensor != nullptr &&
+        score_sum_tensor[cell * score_sum_c2] < threshold) {
+      continue;
+    }
+    int max_class_id = -1;
+    float max_score = 0;
+    const float *block = score_tensor + cell * layout.c2;
+    for (int c = 0; c < class_num; block += block_len) {
+      for (int k = 0; k < layout.c2 && c < class_num; k++, c++) {
+        if ((block[k] > threshold) && (block[k] > max_score)) {
+          max_score = block[k];
           max_class_id = c;
         }
-        offset += grid_len;  // 计算 i * grid_w + j
-        // 这个像素点下，下一个类别偏移量，所以加上一个通道的长度即可
       }
+    }
+    if (max_score > threshold) {
+      candidates.push_back({max_score, max_class_id, branch, cell});
+    }
+  }
+}
 
-      // compute box， 只有最大概率大于阈值，才判定有目标存在
-      if (max_score > score_thres_i8) {
-        for (int k = 0; k < PROTO_CHANNEL; k++) {
-          // 数据转换为int8， 因为数据是NCHW，所以步长需要grid_len才能拿到数据
-          int8_t seg_element_i8 = in_ptr_seg[(k)*grid_len] - seg_zp;
-          segments.push_back(seg_element_i8);
-        }
-
-        offset = i * grid_w + j;
-        float box[4];
-        float before_dfl[dfl_len * 4];
-        for (int k = 0; k < dfl_len * 4; k++) {  // 反量化拿到浮点型数据
-          before_dfl[k] =
-              deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
-          offset += grid_len;
+// fp16的输出直接比较位模式：阈值是正数，大于它的fp16按有符号整数比较的顺序
+// 和数值的顺序相同，只有选中的分数才转换成fp32
+static void collect_candidates_fp16(const int16_t *score_tensor,
+                                    const int16_t *score_sum_tensor,
+                                    int score_sum_c2, int class_num,
+                                    const tensor_layout_t &layout, int branch,
+                                    int cell_begin, int cell_end,
+                                    float threshold,
+                                    std::vector<candidate_t> &candidates) {
+  int16_t score_thres_f16 = (int16_t)rknpu2::float16::bits(threshold);
+  int block_len = layout.plane * layout.c2;
+  for (int cell = cell_begin; cell < cell_end; cell++) {
+    if (score_sum_tensor != nullptr &&
+        score_sum_tensor[cell * score_sum_c2] < score_thres_f16) {
+      continue;
+    }
+    int max_class_id = -1;
+    int16_t max_score = score_thres_f16;
+    const int16_t *block = score_tensor + cell * layout.c2;
+    for (int c = 0; c < class_num; block += block_len) {
+      for (int k = 0; k < layout.c2 && c < class_num; k++, c++) {
+        if (block[k] > max_score) {
+          max_score = block[k];
+          max_class_id = c;
         }
-        // 通过dfl计算出box的坐标
-        compute_dfl(before_dfl, dfl_len, box);
-
-        float x1, y1, x2, y2, w, h;
-        x1 = (-box[0] + j + 0.5) * stride;
-        y1 = (-box[1] + i + 0.5) * stride;
-        x2 = (box[2] + j + 0.5) * stride;
-        y2 = (box[3] + i + 0.5) * stride;
-        w = x2 - x1;
-        h = y2 - y1;
-        boxes.push_back(x1);
-        boxes.push_back(y1);
-        boxes.push_back(w);
-        boxes.push_back(h);
-        // 保存该类的概率和类id
-        objProbs.push_back(
-            deqnt_affine_to_f32(max_score, score_zp, score_scale));
-        classId.push_back(max_class_id);
-        validCount++;
       }
     }
+    if (max_class_id >= 0) {
+      candidates.push_back(
+          {rknpu2::to_fp32((uint16_t)max_score), max_class_id, branch, cell});
+    }
   }
-  return validCount;
 }
 
-static int process_fp32(rknn_output *all_input, int input_id, int grid_h,
-                        int grid_w, int height, int width, int stride,
-                        int dfl_len, std::vector<float> &boxes,
-                        std::vector<float> &segments, float *proto,
-                        std::vector<float> &objProbs, std::vector<int> &classId,
-                        float threshold) {
-  int validCount = 0;
-  int grid_len = grid_h * grid_w;
-
-  // Skip if input_id is not 0, 4, 8, or 12
-  if (input_id % 4 != 0) {
-    return validCount;
+// 按分数从高到低排列，只保留前top_k个，top_k小于等于0时不限制
+static void select_top_k(std::vector<candidate_t> &candidates, int top_k) {
+  auto higher = [](const candidate_t &a, const candidate_t &b) {
+    return a.score > b.score;
+  };
+  if (top_k > 0 && static_cast<int>(candidates.size()) > top_k) {
+    std::nth_element(candidates.begin(), candidates.begin() + top_k,
+                     candidates.end(), higher);
+    candidates.resize(top_k);
   }
+  std::sort(candidates.begin(), candidates.end(), higher);
+}
 
-  if (input_id == 12) {
-    float *input_proto = (float *)all_input[input_id].buf;
-    for (int i = 0; i < PROTO_CHANNEL * PROTO_HEIGHT * PROTO_WEIGHT; i++) {
-      proto[i] = input_proto[i];
+// 解码一个候选的DFL，box是到四条边的距离（以网格为单位）
+static void decode_dfl(rknn_app_context_t *app_ctx, rknn_output *outputs,
+                       int box_idx, int cell, int dfl_len, float *box) {
+  const tensor_layout_t &layout = app_ctx->output_layouts[box_idx];
+  float before_dfl[dfl_len * 4];
+  if (app_ctx->is_quant) {
+    const int8_t *box_tensor = (int8_t *)outputs[box_idx].buf;
+    int32_t box_zp = app_ctx->output_attrs[box_idx].zp;
+    float box_scale = app_ctx->output_attrs[box_idx].scale;
+    for (int k = 0; k < dfl_len * 4; k++) {
+      before_dfl[k] = deqnt_affine_to_f32(
+          box_tensor[layout_offset(layout, cell, k)], box_zp, box_scale);
+    }
+  } else if (app_ctx->is_fp16) {
+    // 先取出这个网格单元的dfl_len * 4个值，再一次性转换
+    const uint16_t *box_tensor = (uint16_t *)outputs[box_idx].buf;
+    uint16_t before_dfl_f16[dfl_len * 4];
+    for (int k = 0; k < dfl_len * 4; k++) {
+      before_dfl_f16[k] = box_tensor[layout_offset(layout, cell, k)];
+    }
+    rknpu2::to_fp32(before_dfl_f16, before_dfl, dfl_len * 4);
+  } else {
+    const float *box_tensor = (float *)outputs[box_idx].buf;
+    for (int k = 0; k < dfl_len * 4; k++) {
+      before_dfl[k] = box_tensor[layout_offset(layout, cell, k)];
     }
-    return validCount;
   }
+  compute_dfl(before_dfl, dfl_len, box);
+}
 
-  float *box_tensor = (float *)all_input[input_id].buf;
-  float *score_tensor = (float *)all_input[input_id + 1].buf;
-  float *score_sum_tensor = (float *)all_input[input_id + 2].buf;
-  float *seg_tensor = (float *)all_input[input_id + 3].buf;
-
-  for (int i = 0; i < grid_h; i++) {
-    for (int j = 0; j < grid_w; j++) {
-      int offset = i * grid_w + j;
-      int max_class_id = -1;
-
-      int offset_seg = i * grid_w + j;
-      float *in_ptr_seg = seg_tensor + offset_seg;
+// 解码一个候选的检测框，结果是模型输入上的x, y, w, h
+static void decode_candidate_box(rknn_app_context_t *app_ctx,
+                                 rknn_output *outputs, int box_idx,
+                                 int cell, int dfl_len, float *xywh) {
+  int grid_w = app_ctx->output_attrs[box_idx].dims[3];
+  int stride = app_ctx->model_height / app_ctx->output_attrs[box_idx].dims[2];
+  int i = cell / grid_w;
+  int j = cell % grid_w;
+  float box[4];
+  decode_dfl(app_ctx, outputs, box_idx, cell, dfl_len, box);
+  float x1 = (-box[0] + j + 0.5) * stride;
+  float y1 = (-box[1] + i + 0.5) * stride;
+  float x2 = (box[2] + j + 0.5) * stride;
+  float y2 = (box[3] + i + 0.5) * stride;
+  xywh[0] = x1;
+  xywh[1] = y1;
+  xywh[2] = x2 - x1;
+  xywh[3] = y2 - y1;
+}
 
-      // for quick filtering through "score sum"
-      if (score_sum_tensor != nullptr) {
-        if (score_sum_tensor[offset] < threshold) {
-          continue;
-        }
-      }
+// 读取某个输出在网格单元上的一个通道，量化模型按照zp和scale还原，
+// fp16转换成fp32
+static float read_output(rknn_app_context_t *app_ctx, rknn_output *outputs,
+                         int index, int cell, int channel) {
+  int offset = layout_offset(app_ctx->output_layouts[index], cell, channel);
+  if (app_ctx->is_quant) {
+    return deqnt_affine_to_f32(((int8_t *)outputs[index].buf)[offset],
+                               app_ctx->output_attrs[index].zp,
+                               app_ctx->output_attrs[index].scale);
+  }
+  if (app_ctx->is_fp16) {
+    return rknpu2::to_fp32(((uint16_t *)outputs[index].buf)[offset]);
+  }
+  return ((float *)outputs[index].buf)[offset];
+}
 
-      float max_score = 0;
-      for (int c = 0; c < num_labels; c++) {
-        if ((score_tensor[offset] > threshold) &&
-            (score_tensor[offset] > max_score)) {
-          max_score = score_tensor[offset];
-          max_class_id = c;
-        }
-        offset += grid_len;
-      }
+// 一段连续的网格单元，并行解码时每段是一个任务
+typedef struct {
+  int branch;
+  int cell_begin;
+  int cell_end;
+} decode_tile_t;
+
+// 并行解码时每个任务大约处理的网格单元数量，
+// 640x640的模型中80x80的分支按行切成4段，另外两个分支各一段
+static const int kTileCells = 1600;
+// 并行解码检测框时每个任务处理的候选数量
+static const int kBoxChunk = 128;
+
+// 执行count个任务，有辅助线程池时并行执行，等待全部完成之后返回
+static void parallel_for(ThreadPool *pool, int count,
+                         const std::function<void(int)> &func) {
+  if (pool == nullptr || count <= 1) {
+    for (int i = 0; i < count; ++i) {
+      func(i);
+    }
+    return;
+  }
+  std::vector<std::future<void>> results;
+  for (int i = 0; i < count; ++i) {
+    results.push_back(pool->enqueue(func, i));
+  }
+  for (auto &result : results) {
+    result.get();
+  }
+}
 
-      // compute box
-      if (max_score > threshold) {
-        for (int k = 0; k < PROTO_CHANNEL; k++) {
-          float seg_element_f32 = in_ptr_seg[(k)*grid_len];
-          segments.push_back(seg_element_f32);
-        }
+// 收集三个分支的候选，score_sum_offset大于0时是score sum在分支内的下标
+// 有辅助线程池时按分支和行切分，每段写入自己的缓冲区，最后按顺序合并
+static void collect_all_candidates(rknn_app_context_t *app_ctx,
+                                   rknn_output *outputs, int score_sum_offset,
+                                   int class_num, float threshold,
+                                   std::vector<candidate_t> &candidates) {
+  int output_per_branch = app_ctx->io_num.n_output / 3;
+  std::vector<decode_tile_t> tiles;
+  for (int i = 0; i < 3; i++) {
+    int grid_h = app_ctx->output_attrs[i * output_per_branch].dims[2];
+    int grid_w = app_ctx->output_attrs[i * output_per_branch].dims[3];
+    int grid_len = grid_h * grid_w;
+    int tile_len = grid_len;
+    if (app_ctx->decode_pool != nullptr) {
+      tile_len = std::max(1, kTileCells / grid_w) * grid_w;
+    }
+    for (int begin = 0; begin < grid_len; begin += tile_len) {
+      tiles.push_back({i, begin, std::min(begin + tile_len, grid_len)});
+    }
+  }
+  std::vector<std::vector<candidate_t>> tile_candidates(tiles.size());
+  parallel_for(app_ctx->decode_pool, tiles.size(), [&](int t) {
+    const decode_tile_t &tile = tiles[t];
+    int box_idx = tile.branch * output_per_branch;
+    int score_idx = box_idx + 1;
+    const tensor_layout_t &layout = app_ctx->output_layouts[score_idx];
+    int score_sum_idx = score_sum_offset > 0 ? box_idx + score_sum_offset : -1;
+    int score_sum_c2 =
+        score_sum_idx < 0 ? 1 : app_ctx->output_layouts[score_sum_idx].c2;
+    if (app_ctx->is_quant) {
+      collect_candidates_i8(
+          (int8_t *)outputs[score_idx].buf, app_ctx->output_attrs[score_idx].zp,
+          app_ctx->output_attrs[score_idx].scale,
+          score_sum_idx < 0 ? nullptr : (int8_t *)outputs[score_sum_idx].buf,
+          score_sum_idx < 0 ? 0 : app_ctx->output_attrs[score_sum_idx].zp,
+          score_sum_idx < 0 ? 1.0f : app_ctx->output_attrs[score_sum_idx].scale,
+          score_sum_c2, class_num, layout, tile.branch, tile.cell_begin,
+          tile.cell_end, threshold, tile_candidates[t]);
+    } else if (app_ctx->is_fp16) {
+      collect_candidates_fp16(
+          (int16_t *)outputs[score_idx].buf,
+          score_sum_idx < 0 ? nullptr : (int16_t *)outputs[score_sum_idx].buf,
+          score_sum_c2, class_num, layout, tile.branch, tile.cell_begin,
+          tile.cell_end, threshold, tile_candidates[t]);
+    } else {
+      collect_candidates_fp32(
+          (float *)outputs[score_idx].buf,
+          score_sum_idx < 0 ? nullptr : (float *)outputs[score_sum_idx].buf,
+          score_sum_c2, class_num, layout, tile.branch, tile.cell_begin,
+          tile.cell_end, threshold, tile_candidates[t]);
+    }
+  });
+  for (auto &tile : tile_candidates) {
+    candidates.insert(candidates.end(), tile.begin(), tile.end());
+  }
+}
 
-        offset = i * grid_w + j;
-        float box[4];
-        float before_dfl[dfl_len * 4];
-        for (int k = 0; k < dfl_len * 4; k++) {
-          before_dfl[k] = box_tensor[offset];
-          offset += grid_len;
-        }
-        compute_dfl(before_dfl, dfl_len, box);
-
-        float x1, y1, x2, y2, w, h;
-        x1 = (-box[0] + j + 0.5) * stride;
-        y1 = (-box[1] + i + 0.5) * stride;
-        x2 = (box[2] + j + 0.5) * stride;
-        y2 = (box[3] + i + 0.5) * stride;
-        w = x2 - x1;
-        h = y2 - y1;
-        boxes.push_back(x1);
-        boxes.push_back(y1);
-        boxes.push_back(w);
-        boxes.push_back(h);
-
-        objProbs.push_back(max_score);
-        classId.push_back(max_class_id);
-        validCount++;
-      }
+// 收集三个分支的候选，选出top_k个并解码检测框，
+// 结果按分数从高到低排列，和NMS需要的顺序一致
+static int collect_top_k(rknn_app_context_t *app_ctx, rknn_output *outputs,
+                         int score_sum_offset, int class_num,
+                         float threshold, std::vector<candidate_t> &candidates,
+                         std::vector<float> &filterBoxes,
+                         std::vector<float> &objProbs,
+                         std::vector<int> &classId) {
+  int dfl_len = app_ctx->output_attrs[0].dims[1] / 4;
+  int output_per_branch = app_ctx->io_num.n_output / 3;
+  collect_all_candidates(app_ctx, outputs, score_sum_offset, class_num,
+                         threshold, candidates);
+  int candidate_count = candidates.size();
+  select_top_k(candidates, app_ctx->pre_nms_top_k);
+  if (candidate_count > static_cast<int>(candidates.size())) {
+    KAYLORDUT_LOG_DEBUG("keep top {} of {} candidates", candidates.size(),
+                        candidate_count);
+  }
+  int count = candidates.size();
+  filterBoxes.resize(count * 4);
+  int chunk_count = app_ctx->decode_pool == nullptr
+                        ? 1
+                        : (count + kBoxChunk - 1) / kBoxChunk;
+  int chunk_len = (count + chunk_count - 1) / std::max(1, chunk_count);
+  parallel_for(app_ctx->decode_pool, chunk_count, [&](int chunk) {
+    int end = std::min(count, (chunk + 1) * chunk_len);
+    for (int n = chunk * chunk_len; n < end; ++n) {
+      decode_candidate_box(app_ctx, outputs,
+                           candidates[n].branch * output_per_branch,
+                           candidates[n].cell, dfl_len, &filterBoxes[n * 4]);
     }
+  });
+  for (const auto &candidate : candidates) {
+    objProbs.push_back(candidate.score);
+    classId.push_back(candidate.cls_id);
   }
-  return validCount;
+  return count;
 }
 
 int post_process_seg(rknn_app_context_t *app_ctx, rknn_output *outputs,
@@ -718,55 +762,29 @@ int post_process_seg(rknn_app_context_t *app_ctx, rknn_output *outputs,
   std::vector<float> filterBoxes;  // 用来保存检测目标的box
   std::vector<float> objProbs;     // 保存该目标的得分
   std::vector<int> classId;        // 保留该目标的种类对应的index id
+  std::vector<candidate_t> candidates;
 
-  std::vector<float> filterSegments;
-  float proto[PROTO_CHANNEL * PROTO_HEIGHT * PROTO_WEIGHT];
   std::vector<float> filterSegments_by_nms;
 
   int model_in_w = app_ctx->model_width;   // 获取模型的width
   int model_in_h = app_ctx->model_height;  // 获取模型的height
 
-  int validCount = 0;  // 记录有效的输出
-  int stride = 0;      // 活动窗口步长
-  int grid_h = 0;
-  int grid_w = 0;
-
-  int dfl_len = app_ctx->output_attrs[0].dims[1] / 4;
   /***
    * 结果输出有三种输出80x80 40x40
-   * 20x20，这里取模是为了确定每种输出拥有多少层输出
+   * 20x20，每个分支依次是box、score、score sum和分割系数，最后一层是proto
    */
-  int output_per_branch = app_ctx->io_num.n_output / 3;  // default 3 branch
-
-  // process the outputs of rknn
-  for (int i = 0; i < 13; i++) {
-    grid_h = app_ctx->output_attrs[i].dims[2];  //  这一层输出的高度
-    grid_w = app_ctx->output_attrs[i].dims[3];  // 这一层输出的宽度
-    stride = model_in_h / grid_h;  // 模型边长对输出层取模等于滑动步长
-    // 如果量化了，使用i8的处理方式
-    if (app_ctx->is_quant) {
-      validCount +=
-          process_i8(outputs, i, grid_h, grid_w, model_in_h, model_in_w, stride,
-                     dfl_len, filterBoxes, filterSegments, proto, objProbs,
-                     classId, conf_threshold, app_ctx);
-    } else {
-      validCount +=
-          process_fp32(outputs, i, grid_h, grid_w, model_in_h, model_in_w,
-                       stride, dfl_len, filterBoxes, filterSegments, proto,
-                       objProbs, classId, conf_threshold);
-    }
-  }
-
-  // nms
+  int output_per_branch = 4;
+  int validCount = collect_top_k(app_ctx, outputs, 2, num_labels,
+                                 conf_threshold, candidates, filterBoxes,
+                                 objProbs, classId);
   if (validCount <= 0) {
     return 0;
   }
+  // 候选已经按分数从高到低排列
   std::vector<int> indexArray;
   for (int i = 0; i < validCount; ++i) {
     indexArray.push_back(i);
   }
-  // 这里快排把识别的种类概率从大到小排列，对应的index也跟着排列
-  quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
 
   std::set<int> class_set(std::begin(classId), std::end(classId));
 
@@ -791,9 +809,11 @@ int post_process_seg(rknn_app_context_t *app_ctx, rknn_output *outputs,
     int id = classId[n];
     float obj_conf = objProbs[i];
 
+    // 只有NMS之后保留下来的目标才读取分割系数
+    int seg_idx = candidates[n].branch * output_per_branch + 3;
     for (int k = 0; k < PROTO_CHANNEL; k++) {
-      // 获取相对应的分割的向量
-      filterSegments_by_nms.push_back(filterSegments[n * PROTO_CHANNEL + k]);
+      filterSegments_by_nms.push_back(
+          read_output(app_ctx, outputs, seg_idx, candidates[n].cell, k));
     }
 
     od_results->results[last_count].box.left = x1;
@@ -809,471 +829,74 @@ int post_process_seg(rknn_app_context_t *app_ctx, rknn_output *outputs,
 
   int boxes_num = od_results->count;
 
-  // compute the mask (binary matrix) through Matmul
-  // 计算掩膜矩阵，最后结果得到 boxes_num 个掩膜矩阵
-  int ROWS_A = boxes_num;
-  int COLS_A = PROTO_CHANNEL;
-  int COLS_B = PROTO_HEIGHT * PROTO_WEIGHT;
-  uint8_t matmul_out[boxes_num * PROTO_HEIGHT * PROTO_WEIGHT];
-  if (app_ctx->is_quant) {
-    matmul_by_npu_i8(filterSegments_by_nms, proto, matmul_out, ROWS_A, COLS_A,
-                     COLS_B, app_ctx);
-  } else {
-    matmul_by_npu_fp16(filterSegments_by_nms, proto, matmul_out, ROWS_A, COLS_A,
-                       COLS_B, app_ctx);
-  }
-
-  float filterBoxes_by_nms[boxes_num * 4];  // 记录每个box的坐标
-  int cls_id[boxes_num];
+  int ori_in_height = (model_in_h - letter_box->y_pad * 2) / letter_box->scale;
+  int ori_in_width = (model_in_w - letter_box->x_pad * 2) / letter_box->scale;
+  // 640 / 160 = 4
+  float proto_stride = static_cast<float>(model_in_w) / PROTO_WEIGHT;
+  // 第12层是proto，每个实例只读取检测框覆盖的部分
+  proto_tensor_t proto = {outputs[12].buf, app_ctx->output_layouts[12],
+                          PROTO_WEIGHT, PROTO_HEIGHT, app_ctx->is_quant,
+                          app_ctx->is_fp16, app_ctx->output_attrs[12].zp};
   for (int i = 0; i < boxes_num; i++) {
-    // for crop_mask
-    // 掩膜层的分辨率是 160x160
-    // 640 / 160 = 4.0
-    filterBoxes_by_nms[i * 4 + 0] =
-        od_results->results[i].box.left / 4.0;  // x1;
-    filterBoxes_by_nms[i * 4 + 1] =
-        od_results->results[i].box.top / 4.0;  // y1;
-    filterBoxes_by_nms[i * 4 + 2] =
-        od_results->results[i].box.right / 4.0;  // x2;
-    filterBoxes_by_nms[i * 4 + 3] =
-        od_results->results[i].box.bottom / 4.0;  // y2;
-    cls_id[i] = od_results->results[i].cls_id;
-
     // get real box
-    // 这里是把640x640的坐标映射返回到原始输入图像的坐标
-    od_results->results[i].box.left =
-        box_reverse(od_results->results[i].box.left, model_in_w,
-                    letter_box->x_pad, letter_box->scale);
-    od_results->results[i].box.top =
-        box_reverse(od_results->results[i].box.top, model_in_h,
-                    letter_box->y_pad, letter_box->scale);
-    od_results->results[i].box.right =
-        box_reverse(od_results->results[i].box.right, model_in_w,
-                    letter_box->x_pad, letter_box->scale);
-    od_results->results[i].box.bottom =
-        box_reverse(od_results->results[i].box.bottom, model_in_h,
-                    letter_box->y_pad, letter_box->scale);
+    // 这里是把640x640的坐标映射返回到原始输入图像的坐标，并限制在原图之内
+    auto &box = od_results->results[i].box;
+    box.left = std::max(0, box_reverse(box.left, model_in_w, letter_box->x_pad,
+                                       letter_box->scale));
+    box.top = std::max(0, box_reverse(box.top, model_in_h, letter_box->y_pad,
+                                      letter_box->scale));
+    box.right =
+        std::min(ori_in_width, box_reverse(box.right, model_in_w,
+                                           letter_box->x_pad,
+                                           letter_box->scale));
+    box.bottom =
+        std::min(ori_in_height, box_reverse(box.bottom, model_in_h,
+                                            letter_box->y_pad,
+                                            letter_box->scale));
+    // 每个实例只计算检测框内的掩码，耗时和内存都和目标的面积成正比
+    instance_mask(filterSegments_by_nms.data() + i * PROTO_CHANNEL, proto,
+                  proto_stride, box, letter_box, &od_results->results_seg[i]);
   }
 
-  // crop seg outside box
-  uint8_t all_mask_in_one[PROTO_HEIGHT * PROTO_WEIGHT] = {0};
-  // 把所有的掩膜数据写到一张图上
-  crop_mask(matmul_out, all_mask_in_one, filterBoxes_by_nms, boxes_num, cls_id,
-            PROTO_HEIGHT, PROTO_WEIGHT);
-
-  // get real mask
-  int cropped_height = PROTO_HEIGHT - letter_box->y_pad / 4 * 2;
-  int cropped_width = PROTO_WEIGHT - letter_box->x_pad / 4 * 2;
-  int y_pad = letter_box->y_pad / 4;  // 640 / 160 = 4
-  int x_pad = letter_box->x_pad / 4;
-  int ori_in_height = (model_in_h - letter_box->y_pad * 2) / letter_box->scale;
-  int ori_in_width = (model_in_w - letter_box->x_pad * 2) / letter_box->scale;
-  uint8_t *cropped_seg_mask =
-      (uint8_t *)malloc(cropped_height * cropped_width * sizeof(uint8_t));
-  uint8_t *real_seg_mask =
-      (uint8_t *)malloc(ori_in_height * ori_in_width * sizeof(uint8_t));
-  // 还原到原来的图像分辨率，结果保存到real_seg_mask中，使用od_results->results_seg[0].seg_mask记录
-  seg_reverse(all_mask_in_one, cropped_seg_mask, real_seg_mask, model_in_h,
-              model_in_w, PROTO_HEIGHT, PROTO_WEIGHT, cropped_height,
-              cropped_width, ori_in_height, ori_in_width, y_pad, x_pad);
-  od_results->results_seg[0].seg_mask = real_seg_mask;
-  free(cropped_seg_mask);
-
   return 0;
 }
 
-static int process_i8_obb(int8_t *box_tensor, int32_t box_zp, float box_scale,
-                          int8_t *score_tensor, int32_t score_zp,
-                          float score_scale, int8_t *angle_tensor,
-                          int32_t angle_zp, float angle_scale, int grid_h,
-                          int grid_w, int stride, int dfl_len,
-                          std::vector<float> &boxes, std::vector<float> &angles,
-                          std::vector<float> &objProbs,
-                          std::vector<int> &classId, float threshold) {
-  //  KAYLORDUT_LOG_DEBUG("process_i8_obb is called");
-  int validCount = 0;
-  int grid_len = grid_h * grid_w;
-  int8_t score_thres_i8 = qnt_f32_to_affine(threshold, score_zp, score_scale);
-
-  for (int i = 0; i < grid_h; i++) {
-    for (int j = 0; j < grid_w; j++) {
-      int offset = i * grid_w + j;
-      int max_class_id = -1;
-
-      int8_t max_score = -score_zp;
-
-      for (int c = 0; c < num_labels; c++) {
-        if ((score_tensor[offset] > score_thres_i8) &&
-            (score_tensor[offset] > max_score)) {
-          max_score = score_tensor[offset];
-          max_class_id = c;
-          //          KAYLORDUT_LOG_INFO("threshold is {}, {} score is {}",
-          //                              threshold,
-          //                              coco_cls_to_name(c),
-          //                              deqnt_affine_to_f32(score_tensor[offset],
-          //                              score_zp, score_scale));
-        }
-        offset += grid_len;
-      }
-
-      // compute box
-      if (max_score > score_thres_i8) {
-        offset = i * grid_w + j;
-        float box[4];
-        float before_dfl[dfl_len * 4];
-        for (int k = 0; k < dfl_len * 4; k++) {
-          before_dfl[k] =
-              deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
-          offset += grid_len;
-        }
-        compute_dfl(before_dfl, dfl_len, box);
-
-        //        float x1, y1, x2, y2, w, h;
-        //        x1 = (-box[0] + j + 0.5) * stride;
-        //        y1 = (-box[1] + i + 0.5) * stride;
-        //        x2 = (box[2] + j + 0.5) * stride;
-        //        y2 = (box[3] + i + 0.5) * stride;
-        //        w = x2 - x1;
-        //        h = y2 - y1;
-        offset = i * grid_w + j;
-        float delta_x1, delta_y1, delta_x2, delta_y2;
-        float theta =
-            deqnt_affine_to_f32(angle_tensor[offset], angle_zp, angle_scale);
-        //        KAYLORDUT_LOG_DEBUG("theta = {}", theta);
-        delta_x1 = box[0];
-        delta_y1 = box[1];
-        delta_x2 = box[2];
-        delta_y2 = box[3];
-        float xf = (delta_x2 - delta_x1) / 2.0f;
-        float yf = (delta_y2 - delta_y1) / 2.0f;
-        float x = xf * cos(theta) - yf * sin(theta);
-        float y = xf * sin(theta) + yf * cos(theta);
-        x = (x + j + 0.5) * stride;
-        y = (y + i + 0.5) * stride;
-        float w = (delta_x1 + delta_x2) * stride;
-        float h = (delta_y1 + delta_y2) * stride;
-        boxes.push_back(x);
-        boxes.push_back(y);
-        boxes.push_back(w);
-        boxes.push_back(h);
-
-        angles.push_back(theta);
-        objProbs.push_back(
-            deqnt_affine_to_f32(max_score, score_zp, score_scale));
-        classId.push_back(max_class_id);
-        validCount++;
-      }
-    }
-  }
-  //  KAYLORDUT_LOG_DEBUG("process_i8_obb finished");
-  return validCount;
-}
-
-static int process_i8_pose(int8_t *box_tensor, int32_t box_zp, float box_scale,
-                           int8_t *score_tensor, int32_t score_zp,
-                           float score_scale, int8_t *kpt_tensor,
-                           int32_t kpt_zp, float kpt_scale,
-                           int8_t *visibility_tensor, int32_t visibility_zp,
-                           float visibility_scale, int grid_h, int grid_w,
-                           int stride, int dfl_len, std::vector<float> &boxes,
-                           std::vector<float> &objProbs,
-                           std::vector<float> &kpt,
-                           std::vector<float> &visibilities, float threshold) {
-  int validCount = 0;
-  int grid_len = grid_h * grid_w;
-  int8_t score_thres_i8 = qnt_f32_to_affine(threshold, score_zp, score_scale);
-
-  for (int i = 0; i < grid_h; i++) {
-    for (int j = 0; j < grid_w; j++) {
-      int offset = i * grid_w + j;
-      int max_class_id = -1;
-
-      int8_t max_score = -score_zp;
-      for (int c = 0; c < num_labels; c++) {
-        if ((score_tensor[offset] > score_thres_i8) &&
-            (score_tensor[offset] > max_score)) {
-          max_score = score_tensor[offset];
-          max_class_id = c;
-        }
-        offset += grid_len;
-      }
-
-      // compute box
-      if (max_score > score_thres_i8) {
-        offset = i * grid_w + j;
-        float box[4];
-        float before_dfl[dfl_len * 4];
-        for (int k = 0; k < dfl_len * 4; k++) {
-          before_dfl[k] =
-              deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
-          offset += grid_len;
-        }
-        compute_dfl(before_dfl, dfl_len, box);
-
-        float x1, y1, x2, y2, w, h;
-        x1 = (-box[0] + j + 0.5) * stride;
-        y1 = (-box[1] + i + 0.5) * stride;
-        x2 = (box[2] + j + 0.5) * stride;
-        y2 = (box[3] + i + 0.5) * stride;
-        w = x2 - x1;
-        h = y2 - y1;
-        boxes.push_back(x1);
-        boxes.push_back(y1);
-        boxes.push_back(w);
-        boxes.push_back(h);
-
-        objProbs.push_back(
-            deqnt_affine_to_f32(max_score, score_zp, score_scale));
-        offset = i * grid_w + j;
-        for (int k = 0; k < 17; ++k) {
-          auto kpt_x = *(kpt_tensor + offset + 2 * k * grid_len);
-          auto kpt_y = *(kpt_tensor + offset + (2 * k + 1) * grid_len);
-          auto kpt_visibility = *(visibility_tensor + offset + k * grid_len);
-          auto res_kpt_x = deqnt_affine_to_f32(kpt_x, kpt_zp, kpt_scale);
-          auto res_kpt_y = deqnt_affine_to_f32(kpt_y, kpt_zp, kpt_scale);
-          auto res_kpt_visibility = deqnt_affine_to_f32(
-              kpt_visibility, visibility_zp, visibility_scale);
-          kpt.push_back(res_kpt_x);
-          kpt.push_back(res_kpt_y);
-          visibilities.push_back(res_kpt_visibility);
-        }
-        validCount++;
-      }
-    }
-  }
-  return validCount;
-}
-static int process_i8(int8_t *box_tensor, int32_t box_zp, float box_scale,
-                      int8_t *score_tensor, int32_t score_zp, float score_scale,
-                      int8_t *score_sum_tensor, int32_t score_sum_zp,
-                      float score_sum_scale, int grid_h, int grid_w, int stride,
-                      int dfl_len, std::vector<float> &boxes,
-                      std::vector<float> &objProbs, std::vector<int> &classId,
-                      float threshold) {
-  int validCount = 0;
-  int grid_len = grid_h * grid_w;
-  int8_t score_thres_i8 = qnt_f32_to_affine(threshold, score_zp, score_scale);
-  int8_t score_sum_thres_i8 =
-      qnt_f32_to_affine(threshold, score_sum_zp, score_sum_scale);
-
-  for (int i = 0; i < grid_h; i++) {
-    for (int j = 0; j < grid_w; j++) {
-      int offset = i * grid_w + j;
-      int max_class_id = -1;
-
-      // 通过 score sum 起到快速过滤的作用
-      if (score_sum_tensor != nullptr) {
-        if (score_sum_tensor[offset] < score_sum_thres_i8) {
-          continue;
-        }
-      }
-
-      int8_t max_score = -score_zp;
-      for (int c = 0; c < num_labels; c++) {
-        if ((score_tensor[offset] > score_thres_i8) &&
-            (score_tensor[offset] > max_score)) {
-          max_score = score_tensor[offset];
-          max_class_id = c;
-        }
-        offset += grid_len;
-      }
-
-      // compute box
-      if (max_score > score_thres_i8) {
-        offset = i * grid_w + j;
-        float box[4];
-        float before_dfl[dfl_len * 4];
-        for (int k = 0; k < dfl_len * 4; k++) {
-          before_dfl[k] =
-              deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
-          offset += grid_len;
-        }
-        compute_dfl(before_dfl, dfl_len, box);
-
-        float x1, y1, x2, y2, w, h;
-        x1 = (-box[0] + j + 0.5) * stride;
-        y1 = (-box[1] + i + 0.5) * stride;
-        x2 = (box[2] + j + 0.5) * stride;
-        y2 = (box[3] + i + 0.5) * stride;
-        w = x2 - x1;
-        h = y2 - y1;
-        boxes.push_back(x1);
-        boxes.push_back(y1);
-        boxes.push_back(w);
-        boxes.push_back(h);
-
-        objProbs.push_back(
-            deqnt_affine_to_f32(max_score, score_zp, score_scale));
-        classId.push_back(max_class_id);
-        validCount++;
-      }
-    }
-  }
-  return validCount;
-}
-
-static int process_i8_v10(int8_t *box_tensor, int32_t box_zp, float box_scale,
-                          int8_t *score_tensor, int32_t score_zp,
-                          float score_scale, int grid_h, int grid_w, int stride,
-                          int dfl_len, std::vector<float> &boxes,
-                          std::vector<float> &objProbs,
-                          std::vector<int> &classId, float threshold) {
-  int validCount = 0;
-  int grid_len = grid_h * grid_w;
-  int8_t score_thres_i8 = qnt_f32_to_affine(threshold, score_zp, score_scale);
-
-  for (int i = 0; i < grid_h; i++) {
-    for (int j = 0; j < grid_w; j++) {
-      int offset = i * grid_w + j;
-      int max_class_id = -1;
-
-      int8_t max_score = -score_zp;
-      for (int c = 0; c < num_labels; c++) {
-        if ((score_tensor[offset] > score_thres_i8) &&
-            (score_tensor[offset] > max_score)) {
-          max_score = score_tensor[offset];
-          max_class_id = c;
-        }
-        offset += grid_len;
-      }
-
-      // compute box
-      if (max_score > score_thres_i8) {
-        offset = i * grid_w + j;
-        float box[4];
-        float before_dfl[dfl_len * 4];
-        for (int k = 0; k < dfl_len * 4; k++) {
-          before_dfl[k] =
-              deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
-          offset += grid_len;
-        }
-        compute_dfl(before_dfl, dfl_len, box);
-
-        float x1, y1, x2, y2, w, h;
-        x1 = (-box[0] + j + 0.5) * stride;
-        y1 = (-box[1] + i + 0.5) * stride;
-        x2 = (box[2] + j + 0.5) * stride;
-        y2 = (box[3] + i + 0.5) * stride;
-        w = x2 - x1;
-        h = y2 - y1;
-        boxes.push_back(x1);
-        boxes.push_back(y1);
-        boxes.push_back(w);
-        boxes.push_back(h);
-
-        objProbs.push_back(
-            deqnt_affine_to_f32(max_score, score_zp, score_scale));
-        classId.push_back(max_class_id);
-        validCount++;
-      }
-    }
-  }
-  return validCount;
-}
-static int process_fp32(float *box_tensor, float *score_tensor,
-                        float *score_sum_tensor, int grid_h, int grid_w,
-                        int stride, int dfl_len, std::vector<float> &boxes,
-                        std::vector<float> &objProbs, std::vector<int> &classId,
-                        float threshold) {
-  int validCount = 0;
-  int grid_len = grid_h * grid_w;
-  for (int i = 0; i < grid_h; i++) {
-    for (int j = 0; j < grid_w; j++) {
-      int offset = i * grid_w + j;
-      int max_class_id = -1;
-
-      // 通过 score sum 起到快速过滤的作用
-      if (score_sum_tensor != nullptr) {
-        if (score_sum_tensor[offset] < threshold) {
-          continue;
-        }
-      }
-
-      float max_score = 0;
-      for (int c = 0; c < num_labels; c++) {
-        if ((score_tensor[offset] > threshold) &&
-            (score_tensor[offset] > max_score)) {
-          max_score = score_tensor[offset];
-          max_class_id = c;
-        }
-        offset += grid_len;
-      }
-
-      // compute box
-      if (max_score > threshold) {
-        offset = i * grid_w + j;
-        float box[4];
-        float before_dfl[dfl_len * 4];
-        for (int k = 0; k < dfl_len * 4; k++) {
-          before_dfl[k] = box_tensor[offset];
-          offset += grid_len;
-        }
-        compute_dfl(before_dfl, dfl_len, box);
-
-        float x1, y1, x2, y2, w, h;
-        x1 = (-box[0] + j + 0.5) * stride;
-        y1 = (-box[1] + i + 0.5) * stride;
-        x2 = (box[2] + j + 0.5) * stride;
-        y2 = (box[3] + i + 0.5) * stride;
-        w = x2 - x1;
-        h = y2 - y1;
-        boxes.push_back(x1);
-        boxes.push_back(y1);
-        boxes.push_back(w);
-        boxes.push_back(h);
-
-        objProbs.push_back(max_score);
-        classId.push_back(max_class_id);
-        validCount++;
-      }
-    }
+// 解码一个候选框的17个关键点，坐标换算到原图
+static void decode_pose_keypoints(rknn_app_context_t *app_ctx,
+                                  rknn_output *outputs, int branch, int cell,
+                                  const letterbox_t *letter_box,
+                                  object_pose_result *pose) {
+  int output_per_branch = app_ctx->io_num.n_output / 3;
+  int kpt_idx = branch * output_per_branch + 2;
+  int visibility_idx = branch * output_per_branch + 3;
+  for (int k = 0; k < 17; ++k) {
+    float x = read_output(app_ctx, outputs, kpt_idx, cell, 2 * k);
+    float y = read_output(app_ctx, outputs, kpt_idx, cell, 2 * k + 1);
+    float visibility = read_output(app_ctx, outputs, visibility_idx, cell, k);
+    pose->kpt[2 * k] = (x - letter_box->x_pad) / letter_box->scale;
+    pose->kpt[2 * k + 1] = (y - letter_box->y_pad) / letter_box->scale;
+    pose->visibility[k] = visibility;
   }
-  return validCount;
 }
 
+// int8、fp16和fp32的输出共用检测的候选收集（collect_top_k）和read_output，
+// 没有单独的浮点姿态解码；fp16的输出不转换成float，按fp16读取
 int post_process_pose(rknn_app_context_t *app_ctx, rknn_output *outputs,
                       letterbox_t *letter_box, float conf_threshold,
                       float nms_threshold,
                       object_detect_result_list *od_results) {
   std::vector<float> filterBoxes;
   std::vector<float> objProbs;
-  std::vector<float> kpt;
-  std::vector<float> visibilities;
-  int validCount = 0;
-  int stride = 0;
-  int grid_h = 0;
-  int grid_w = 0;
+  std::vector<int> classId;
+  // 每个候选框所在的分支和网格单元，用于NMS之后解码关键点
+  std::vector<candidate_t> candidates;
   int model_in_w = app_ctx->model_width;
   int model_in_h = app_ctx->model_height;
 
-  // default 3 branch
-  int dfl_len = app_ctx->output_attrs[0].dims[1] / 4;
-  int output_per_branch = app_ctx->io_num.n_output / 3;
-  for (int i = 0; i < 3; i++) {
-    int box_idx = i * output_per_branch;
-    int score_idx = i * output_per_branch + 1;
-    int kpt_idx = i * output_per_branch + 2;
-    int visibilities_idx = i * output_per_branch + 3;
-
-    grid_h = app_ctx->output_attrs[box_idx].dims[2];
-    grid_w = app_ctx->output_attrs[box_idx].dims[3];
-    num_labels = app_ctx->output_attrs[score_idx].dims[1];
-    stride = model_in_h / grid_h;
-
-    if (app_ctx->is_quant) {
-      validCount += process_i8_pose(
-          (int8_t *)outputs[box_idx].buf, app_ctx->output_attrs[box_idx].zp,
-          app_ctx->output_attrs[box_idx].scale,
-          (int8_t *)outputs[score_idx].buf, app_ctx->output_attrs[score_idx].zp,
-          app_ctx->output_attrs[score_idx].scale,
-          (int8_t *)outputs[kpt_idx].buf, app_ctx->output_attrs[kpt_idx].zp,
-          app_ctx->output_attrs[kpt_idx].scale,
-          (int8_t *)outputs[visibilities_idx].buf,
-          app_ctx->output_attrs[visibilities_idx].zp,
-          app_ctx->output_attrs[visibilities_idx].scale, grid_h, grid_w, stride,
-          dfl_len, filterBoxes, objProbs, kpt, visibilities, conf_threshold);
-    }
-  }
+  num_labels = app_ctx->output_attrs[1].dims[1];
+  int validCount = collect_top_k(app_ctx, outputs, 0, num_labels,
+                                 conf_threshold, candidates, filterBoxes,
+                                 objProbs, classId);
 
   // no object detect
   if (validCount <= 0) {
@@ -1283,7 +906,6 @@ int post_process_pose(rknn_app_context_t *app_ctx, rknn_output *outputs,
   for (int i = 0; i < validCount; ++i) {
     indexArray.push_back(i);
   }
-  quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
   // 因为Pose只有人类一个种类， 所以只有nms可以简化
   nms(validCount, filterBoxes, indexArray, nms_threshold);
 
@@ -1312,16 +934,9 @@ int post_process_pose(rknn_app_context_t *app_ctx, rknn_output *outputs,
     od_results->results[last_count].box.bottom =
         (int)(clamp(y2, 0, model_in_h) / letter_box->scale);
     od_results->results[last_count].prop = obj_conf;
-    for (int j = 0; j < 34; j = j + 2) {
-      auto kpt_x = kpt.at(34 * n + j) - letter_box->x_pad;
-      auto kpt_y = kpt.at(34 * n + j + 1) - letter_box->y_pad;
-      kpt_x /= letter_box->scale;
-      kpt_y /= letter_box->scale;
-      od_results->results_pose[last_count].kpt[j] = kpt_x;
-      od_results->results_pose[last_count].kpt[j + 1] = kpt_y;
-      od_results->results_pose[last_count].visibility[j / 2] =
-          visibilities.at(17 * n + j / 2);
-    }
+    decode_pose_keypoints(app_ctx, outputs, candidates[n].branch,
+                          candidates[n].cell, letter_box,
+                          &od_results->results_pose[last_count]);
     last_count++;
   }
   od_results->count = last_count;
@@ -1330,58 +945,137 @@ int post_process_pose(rknn_app_context_t *app_ctx, rknn_output *outputs,
   return 0;
 }
 
+// yolov10的一对一检测头：按内存的顺序逐块扫描分数，连续访问内存，
+// 记录每个网格单元的最大分数和类别。NCHW时每块是一个类别的平面
+template <typename T>
+static void scan_class_planes(const T *score_tensor, int class_num,
+                              const tensor_layout_t &layout, T threshold,
+                              T *max_score, int *max_class_id) {
+  std::fill(max_score, max_score + layout.plane, threshold);
+  std::fill(max_class_id, max_class_id + layout.plane, -1);
+  for (int c1 = 0; c1 * layout.c2 < class_num; c1++) {
+    const T *block = score_tensor + c1 * layout.plane * layout.c2;
+    int channels = std::min(layout.c2, class_num - c1 * layout.c2);
+    for (int cell = 0; cell < layout.plane; cell++) {
+      for (int k = 0; k < channels; k++) {
+        if (block[cell * layout.c2 + k] > max_score[cell]) {
+          max_score[cell] = block[cell * layout.c2 + k];
+          max_class_id[cell] = c1 * layout.c2 + k;
+        }
+      }
+    }
+  }
+}
+
+// 小顶堆，堆顶是已保留候选中分数最低的一个
+static void push_bounded(std::vector<candidate_t> &heap, int capacity,
+                         const candidate_t &candidate) {
+  auto higher = [](const candidate_t &a, const candidate_t &b) {
+    return a.score > b.score;
+  };
+  if (static_cast<int>(heap.size()) < capacity) {
+    heap.push_back(candidate);
+    std::push_heap(heap.begin(), heap.end(), higher);
+  } else if (candidate.score > heap.front().score) {
+    std::pop_heap(heap.begin(), heap.end(), higher);
+    heap.back() = candidate;
+    std::push_heap(heap.begin(), heap.end(), higher);
+  }
+}
+
+// yolov10不需要NMS，最多输出OBJ_NUMB_MAX_SIZE个结果，
+// 用有界的堆保留分数最高的候选，只解码这些候选的检测框
 int post_process_v10_detection(rknn_app_context_t *app_ctx,
                                rknn_output *outputs, letterbox_t *letter_box,
                                float conf_threshold,
                                object_detect_result_list *od_results) {
-  std::vector<float> filterBoxes;
-  std::vector<float> objProbs;
-  std::vector<int> classId;
-  int validCount = 0;
-  int stride = 0;
-  int grid_h = 0;
-  int grid_w = 0;
   int model_in_w = app_ctx->model_width;
   int model_in_h = app_ctx->model_height;
+  int capacity = OBJ_NUMB_MAX_SIZE;
+  if (app_ctx->pre_nms_top_k > 0) {
+    capacity = std::min(capacity, app_ctx->pre_nms_top_k);
+  }
+  std::vector<candidate_t> heap;
+  heap.reserve(capacity);
 
   // default 3 branch
   int dfl_len = app_ctx->output_attrs[0].dims[1] / 4;
   int output_per_branch = app_ctx->io_num.n_output / 3;
+  int max_grid_len = app_ctx->output_attrs[0].dims[2] *
+                     app_ctx->output_attrs[0].dims[3];
+  std::vector<int> max_class_id(max_grid_len);
+  std::vector<int8_t> max_score_i8;
+  std::vector<int16_t> max_score_fp16;
+  std::vector<float> max_score_fp32;
+  if (app_ctx->is_quant) {
+    max_score_i8.resize(max_grid_len);
+  } else if (app_ctx->is_fp16) {
+    max_score_fp16.resize(max_grid_len);
+  } else {
+    max_score_fp32.resize(max_grid_len);
+  }
   for (int i = 0; i < 3; i++) {
     int box_idx = i * output_per_branch;
-    int score_idx = i * output_per_branch + 1;
-
-    grid_h = app_ctx->output_attrs[box_idx].dims[2];
-    grid_w = app_ctx->output_attrs[box_idx].dims[3];
-    stride = model_in_h / grid_h;
-
+    int score_idx = box_idx + 1;
+    int grid_len = app_ctx->output_attrs[box_idx].dims[2] *
+                   app_ctx->output_attrs[box_idx].dims[3];
     if (app_ctx->is_quant) {
-      validCount += process_i8_v10(
-          (int8_t *)outputs[box_idx].buf, app_ctx->output_attrs[box_idx].zp,
-          app_ctx->output_attrs[box_idx].scale,
-          (int8_t *)outputs[score_idx].buf, app_ctx->output_attrs[score_idx].zp,
-          app_ctx->output_attrs[score_idx].scale, grid_h, grid_w, stride,
-          dfl_len, filterBoxes, objProbs, classId, conf_threshold);
+      int32_t score_zp = app_ctx->output_attrs[score_idx].zp;
+      float score_scale = app_ctx->output_attrs[score_idx].scale;
+      scan_class_planes((int8_t *)outputs[score_idx].buf, num_labels,
+                        app_ctx->output_layouts[score_idx],
+                        qnt_f32_to_affine(conf_threshold, score_zp,
+                                          score_scale),
+                        max_score_i8.data(), max_class_id.data());
+      for (int cell = 0; cell < grid_len; cell++) {
+        if (max_class_id[cell] >= 0) {
+          push_bounded(heap, capacity,
+                       {deqnt_affine_to_f32(max_score_i8[cell], score_zp,
+                                            score_scale),
+                        max_class_id[cell], i, cell});
+        }
+      }
+    } else if (app_ctx->is_fp16) {
+      // 和collect_candidates_fp16一样，按有符号整数比较fp16的位模式
+      scan_class_planes((int16_t *)outputs[score_idx].buf, num_labels,
+                        app_ctx->output_layouts[score_idx],
+                        (int16_t)rknpu2::float16::bits(conf_threshold),
+                        max_score_fp16.data(), max_class_id.data());
+      for (int cell = 0; cell < grid_len; cell++) {
+        if (max_class_id[cell] >= 0) {
+          push_bounded(heap, capacity,
+                       {rknpu2::to_fp32((uint16_t)max_score_fp16[cell]),
+                        max_class_id[cell], i, cell});
+        }
+      }
+    } else {
+      scan_class_planes((float *)outputs[score_idx].buf, num_labels,
+                        app_ctx->output_layouts[score_idx], conf_threshold,
+                        max_score_fp32.data(), max_class_id.data());
+      for (int cell = 0; cell < grid_len; cell++) {
+        if (max_class_id[cell] >= 0) {
+          push_bounded(heap, capacity,
+                       {max_score_fp32[cell], max_class_id[cell], i, cell});
+        }
+      }
     }
   }
-  // no object detect
-  if (validCount <= 0) {
-    return 0;
-  }
-  KAYLORDUT_LOG_INFO("valid count is {}", validCount);
+  // 堆排序之后按分数从高到低排列
+  std::sort_heap(heap.begin(), heap.end(),
+                 [](const candidate_t &a, const candidate_t &b) {
+                   return a.score > b.score;
+                 });
+
   int last_count = 0;
   od_results->count = 0;
-
-  /* box valid detect target */
-  for (int i = 0; i < validCount; ++i) {
-    int n = i;
-
-    float x1 = filterBoxes[n * 4 + 0] - letter_box->x_pad;
-    float y1 = filterBoxes[n * 4 + 1] - letter_box->y_pad;
-    float x2 = x1 + filterBoxes[n * 4 + 2];
-    float y2 = y1 + filterBoxes[n * 4 + 3];
-    int id = classId[n];
-    float obj_conf = objProbs[i];
+  for (const auto &candidate : heap) {
+    float xywh[4];
+    decode_candidate_box(app_ctx, outputs, candidate.branch * output_per_branch,
+                         candidate.cell, dfl_len, xywh);
+    float x1 = xywh[0] - letter_box->x_pad;
+    float y1 = xywh[1] - letter_box->y_pad;
+    float x2 = x1 + xywh[2];
+    float y2 = y1 + xywh[3];
 
     od_results->results[last_count].box.left =
         (int)(clamp(x1, 0, model_in_w) / letter_box->scale);
@@ -1391,8 +1085,8 @@ int post_process_v10_detection(rknn_app_context_t *app_ctx,
         (int)(clamp(x2, 0, model_in_w) / letter_box->scale);
     od_results->results[last_count].box.bottom =
         (int)(clamp(y2, 0, model_in_h) / letter_box->scale);
-    od_results->results[last_count].prop = obj_conf;
-    od_results->results[last_count].cls_id = id;
+    od_results->results[last_count].prop = candidate.score;
+    od_results->results[last_count].cls_id = candidate.cls_id;
     last_count++;
   }
   od_results->count = last_count;
@@ -1405,63 +1099,28 @@ int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs,
   std::vector<float> filterBoxes;
   std::vector<float> objProbs;
   std::vector<int> classId;
-  int validCount = 0;
-  int stride = 0;
-  int grid_h = 0;
-  int grid_w = 0;
+  std::vector<candidate_t> candidates;
   int model_in_w = app_ctx->model_width;
   int model_in_h = app_ctx->model_height;
 
-  // default 3 branch
-  int dfl_len = app_ctx->output_attrs[0].dims[1] / 4;
+  // default 3 branch，每个分支有3个输出时第三个是score sum
   int output_per_branch = app_ctx->io_num.n_output / 3;
-  for (int i = 0; i < 3; i++) {
-    void *score_sum = nullptr;
-    int32_t score_sum_zp = 0;
-    float score_sum_scale = 1.0;
-    if (output_per_branch == 3) {
-      score_sum = outputs[i * output_per_branch + 2].buf;
-      score_sum_zp = app_ctx->output_attrs[i * output_per_branch + 2].zp;
-      score_sum_scale = app_ctx->output_attrs[i * output_per_branch + 2].scale;
-    }
-    int box_idx = i * output_per_branch;
-    int score_idx = i * output_per_branch + 1;
-
-    grid_h = app_ctx->output_attrs[box_idx].dims[2];
-    grid_w = app_ctx->output_attrs[box_idx].dims[3];
-    stride = model_in_h / grid_h;
-
-    if (app_ctx->is_quant) {
-      validCount += process_i8(
-          (int8_t *)outputs[box_idx].buf, app_ctx->output_attrs[box_idx].zp,
-          app_ctx->output_attrs[box_idx].scale,
-          (int8_t *)outputs[score_idx].buf, app_ctx->output_attrs[score_idx].zp,
-          app_ctx->output_attrs[score_idx].scale, (int8_t *)score_sum,
-          score_sum_zp, score_sum_scale, grid_h, grid_w, stride, dfl_len,
-          filterBoxes, objProbs, classId, conf_threshold);
-    } else {
-      validCount += process_fp32(
-          (float *)outputs[box_idx].buf, (float *)outputs[score_idx].buf,
-          (float *)score_sum, grid_h, grid_w, stride, dfl_len, filterBoxes,
-          objProbs, classId, conf_threshold);
-    }
-  }
+  int validCount = collect_top_k(
+      app_ctx, outputs, output_per_branch == 3 ? 2 : 0, num_labels,
+      conf_threshold, candidates, filterBoxes, objProbs, classId);
 
   // no object detect
   if (validCount <= 0) {
     return 0;
   }
+  // 候选已经按分数从高到低排列
   std::vector<int> indexArray;
-  // 如果是Yolov8 就进行nms， yolov10不需要
-  if (od_results->model_type == ModelType::DETECTION) {
-    for (int i = 0; i < validCount; ++i) {
-      indexArray.push_back(i);
-    }
-    quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
-    std::set<int> class_set(std::begin(classId), std::end(classId));
-    for (auto c : class_set) {
-      nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
-    }
+  for (int i = 0; i < validCount; ++i) {
+    indexArray.push_back(i);
+  }
+  std::set<int> class_set(std::begin(classId), std::end(classId));
+  for (auto c : class_set) {
+    nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
   }
 
   int last_count = 0;
@@ -1469,16 +1128,11 @@ int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs,
 
   /* box valid detect target */
   for (int i = 0; i < validCount; ++i) {
-    int n;
-    // 如果是yolov8， 根据nms结果进行操作
-    if (od_results->model_type == ModelType::DETECTION) {
-      if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE) {
-        continue;
-      }
-      n = indexArray[i];
-    } else {
-      n = i;
+    // 上一步中已经标记了无效的重叠框的下标为-1
+    if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE) {
+      continue;
     }
+    int n = indexArray[i];
 
     float x1 = filterBoxes[n * 4 + 0] - letter_box->x_pad;
     float y1 = filterBoxes[n * 4 + 1] - letter_box->y_pad;
@@ -1511,54 +1165,59 @@ int post_process_obb(rknn_app_context_t *app_ctx, rknn_output *outputs,
   std::vector<float> objProbs;     // 置信度
   std::vector<int> classId;        // class id
   std::vector<float> angles;
-  int validCount = 0;
-  int stride = 0;
-  int grid_h = 0;
-  int grid_w = 0;
-  int model_in_w = app_ctx->model_width;
+  std::vector<candidate_t> candidates;
   int model_in_h = app_ctx->model_height;
 
-  // default 3 branch
+  // default 3 branch，每个分支依次是box、score和angle
   int dfl_len = app_ctx->output_attrs[0].dims[1] / 4;
   int output_per_branch = app_ctx->io_num.n_output / 3;
-  for (int i = 0; i < 3; i++) {
-    int box_idx = i * output_per_branch;
-    int score_idx = i * output_per_branch + 1;
-    int angle_idx = i * output_per_branch + 2;
-
-    grid_h = app_ctx->output_attrs[box_idx].dims[2];
-    grid_w = app_ctx->output_attrs[box_idx].dims[3];
-    num_labels = app_ctx->output_attrs[score_idx].dims[1];
-    stride = model_in_h / grid_h;
-
-    if (app_ctx->is_quant) {
-      validCount += process_i8_obb(
-          (int8_t *)outputs[box_idx].buf, app_ctx->output_attrs[box_idx].zp,
-          app_ctx->output_attrs[box_idx].scale,
-          (int8_t *)outputs[score_idx].buf, app_ctx->output_attrs[score_idx].zp,
-          app_ctx->output_attrs[score_idx].scale,
-          (int8_t *)outputs[angle_idx].buf, app_ctx->output_attrs[angle_idx].zp,
-          app_ctx->output_attrs[angle_idx].scale, grid_h, grid_w, stride,
-          dfl_len, filterBoxes, angles, objProbs, classId, conf_threshold);
-    } else {
-      //      validCount += process_fp32(
-      //          (float *)outputs[box_idx].buf, (float
-      //          *)outputs[score_idx].buf, (float *)score_sum, grid_h, grid_w,
-      //          stride, dfl_len, filterBoxes, objProbs, classId,
-      //          conf_threshold);
-    }
-  }
+  num_labels = app_ctx->output_attrs[1].dims[1];
+  collect_all_candidates(app_ctx, outputs, 0, num_labels, conf_threshold,
+                         candidates);
+  select_top_k(candidates, app_ctx->pre_nms_top_k);
+  int validCount = candidates.size();
 
   // no object detect
   if (validCount <= 0) {
     return 0;
   }
   KAYLORDUT_LOG_INFO("valid count is {}", validCount);
+  // 只解码top_k个候选的旋转框
+  for (const auto &candidate : candidates) {
+    int box_idx = candidate.branch * output_per_branch;
+    int grid_w = app_ctx->output_attrs[box_idx].dims[3];
+    int stride = model_in_h / app_ctx->output_attrs[box_idx].dims[2];
+    int i = candidate.cell / grid_w;
+    int j = candidate.cell % grid_w;
+    float box[4];
+    decode_dfl(app_ctx, outputs, box_idx, candidate.cell, dfl_len, box);
+    float theta =
+        read_output(app_ctx, outputs, box_idx + 2, candidate.cell, 0);
+    float delta_x1 = box[0];
+    float delta_y1 = box[1];
+    float delta_x2 = box[2];
+    float delta_y2 = box[3];
+    float xf = (delta_x2 - delta_x1) / 2.0f;
+    float yf = (delta_y2 - delta_y1) / 2.0f;
+    float x = xf * cos(theta) - yf * sin(theta);
+    float y = xf * sin(theta) + yf * cos(theta);
+    x = (x + j + 0.5) * stride;
+    y = (y + i + 0.5) * stride;
+    float w = (delta_x1 + delta_x2) * stride;
+    float h = (delta_y1 + delta_y2) * stride;
+    filterBoxes.push_back(x);
+    filterBoxes.push_back(y);
+    filterBoxes.push_back(w);
+    filterBoxes.push_back(h);
+    angles.push_back(theta);
+    objProbs.push_back(candidate.score);
+    classId.push_back(candidate.cls_id);
+  }
+  // 候选已经按分数从高到低排列
   std::vector<int> indexArray;
   for (int i = 0; i < validCount; ++i) {
     indexArray.push_back(i);
   }
-  quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
 
   std::set<int> class_set(std::begin(classId), std::end(classId));
 
@@ -0,0 +1,67 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "raw_frame.h"
+
+#include <linux/videodev2.h>
+
+#include "frame_pool.h"
+#include "jpeg_decoder.h"
+#include "kaylordut/log/logger.h"
+
+bool parse_pixel_format(const std::string &str, uint32_t *fourcc) {
+  if (str == "mjpeg") {
+    *fourcc = V4L2_PIX_FMT_MJPEG;
+  } else if (str == "yuyv") {
+    *fourcc = V4L2_PIX_FMT_YUYV;
+  } else if (str == "nv12") {
+    *fourcc = V4L2_PIX_FMT_NV12;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool is_yuv_format(uint32_t fourcc) {
+  return fourcc == V4L2_PIX_FMT_YUYV || fourcc == V4L2_PIX_FMT_NV12;
+}
+
+std::shared_ptr<cv::Mat> DecodeRawFrame(const RawFrame &frame,
+                                        cv::Size min_size) {
+  std::shared_ptr<cv::Mat> image;
+  switch (frame.fourcc) {
+    case V4L2_PIX_FMT_MJPEG:
+    case V4L2_PIX_FMT_JPEG: {
+      // 每个推理线程一个解码句柄
+      thread_local JpegDecoder decoder;
+      image = decoder.Decode(frame.data, frame.size, min_size);
+      if (image == nullptr) {
+        return nullptr;
+      }
+      break;
+    }
+    case V4L2_PIX_FMT_YUYV: {
+      cv::Mat yuyv(frame.height, frame.width, CV_8UC2, frame.data);
+      image = FramePool::GetInstance().Acquire(frame.height, frame.width,
+                                               CV_8UC3);
+      cv::cvtColor(yuyv, *image, cv::COLOR_YUV2BGR_YUYV);
+      break;
+    }
+    case V4L2_PIX_FMT_NV12: {
+      cv::Mat nv12(frame.height * 3 / 2, frame.width, CV_8UC1, frame.data);
+      image = FramePool::GetInstance().Acquire(frame.height, frame.width,
+                                               CV_8UC3);
+      cv::cvtColor(nv12, *image, cv::COLOR_YUV2BGR_NV12);
+      break;
+    }
+    default:
+      KAYLORDUT_LOG_ERROR("Unsupported pixel format {:#x}", frame.fourcc);
+      return nullptr;
+  }
+  if (image->empty()) {
+    KAYLORDUT_LOG_ERROR("Decode frame {} failed", frame.sequence);
+    return nullptr;
+  }
+  return image;
+}
@@ -0,0 +1,283 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "result_sink.h"
+
+#include "kaylordut/log/logger.h"
+#include "mask_encoding.h"
+#include "postprocess.h"
+
+ResultSink::ResultSink(size_t capacity, bool drop_oldest)
+    : capacity_(std::max<size_t>(1, capacity)), drop_oldest_(drop_oldest) {}
+
+ResultSink::~ResultSink() { Stop(); }
+
+void ResultSink::Start() { thread_ = std::thread(&ResultSink::Loop, this); }
+
+void ResultSink::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ResultSink::Push(std::shared_ptr<InferenceResult> result) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (queue_.size() >= capacity_) {
+    if (drop_oldest_) {
+      queue_.pop_front();
+      dropped_++;
+    } else {
+      condition_.wait(lock, [this] { return queue_.size() < capacity_; });
+    }
+  }
+  queue_.push_back(std::move(result));
+  condition_.notify_all();
+}
+
+uint64_t ResultSink::get_dropped() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+void ResultSink::Loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      // 退出前处理完队列里所有的结果
+      return;
+    }
+    auto result = std::move(queue_.front());
+    queue_.pop_front();
+    // 通知等待空位的Push
+    condition_.notify_all();
+    lock.unlock();
+    Consume(*result);
+    result.reset();
+    lock.lock();
+  }
+}
+
+VideoSink::VideoSink(const std::string &filename, double fps, cv::Size size,
+                     size_t capacity)
+    : ResultSink(capacity, false), size_(size) {
+  writer_.open(filename, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps,
+               size);
+  if (!writer_.isOpened()) {
+    KAYLORDUT_LOG_ERROR("Open the output video file {} error", filename);
+  }
+  Start();
+}
+
+VideoSink::~VideoSink() {
+  Stop();
+  writer_.release();
+}
+
+bool VideoSink::IsOpened() { return writer_.isOpened(); }
+
+void VideoSink::Consume(const InferenceResult &result) {
+  if (!writer_.isOpened() || result.image == nullptr) {
+    return;
+  }
+  // 按比例解码的帧比视频小，VideoWriter只接受打开时的尺寸
+  if (result.image->size() != size_) {
+    cv::resize(*result.image, resized_, size_);
+    writer_.write(resized_);
+    return;
+  }
+  writer_.write(*result.image);
+}
+
+DetectionSink::DetectionSink(const std::string &filename, Format format,
+                             double fps, size_t capacity)
+    : ResultSink(capacity, false), format_(format), fps_(fps) {
+  output_.open(filename, format_ == Format::BINARY
+                             ? std::ios::out | std::ios::binary
+                             : std::ios::out);
+  if (!output_.is_open()) {
+    KAYLORDUT_LOG_ERROR("Open {} failed", filename);
+  }
+  Start();
+}
+
+DetectionSink::~DetectionSink() { Stop(); }
+
+bool DetectionSink::IsOpened() { return output_.is_open(); }
+
+void DetectionSink::set_mask_format(MaskFormat mask_format) {
+  mask_format_ = mask_format;
+}
+
+void DetectionSink::Consume(const InferenceResult &result) {
+  if (!output_.is_open()) {
+    return;
+  }
+  if (format_ == Format::BINARY) {
+    WriteBinary(result);
+  } else {
+    WriteJson(result);
+  }
+}
+
+void DetectionSink::WriteJson(const InferenceResult &result) {
+  if (!has_first_time_) {
+    first_time_ = result.enqueue_time;
+    has_first_time_ = true;
+  }
+  double time =
+      fps_ > 0 ? result.sequence / fps_
+               : std::chrono::duration<double>(result.enqueue_time -
+                                               first_time_)
+                     .count();
+  const auto &od_results = *result.detections;
+  output_ << "{\"stream\":" << result.stream_id
+          << ",\"frame\":" << result.sequence << ",\"time\":" << time
+          << ",\"detections\":[";
+  for (int i = 0; i < od_results.count; ++i) {
+    output_ << (i == 0 ? "" : ",");
+    if (od_results.model_type == ModelType::OBB) {
+      auto &obb = od_results.results_obb[i];
+      output_ << "{\"class\":\"" << coco_cls_to_name(obb.cls_id)
+              << "\",\"score\":" << obb.prop << ",\"xywht\":[" << obb.box.x
+              << "," << obb.box.y << "," << obb.box.w << "," << obb.box.h
+              << "," << obb.box.theta << "]}";
+    } else {
+      auto &det = od_results.results[i];
+      output_ << "{\"class\":\"" << coco_cls_to_name(det.cls_id)
+              << "\",\"score\":" << det.prop << ",\"box\":[" << det.box.left
+              << "," << det.box.top << "," << det.box.right << ","
+              << det.box.bottom << "]";
+      WriteMask(od_results, i);
+      output_ << "}";
+    }
+  }
+  output_ << "]}\n";
+}
+
+void DetectionSink::WriteMask(const object_detect_result_list &od_results,
+                              int index) {
+  const auto &seg_result = od_results.results_seg[index];
+  if (od_results.model_type != ModelType::SEGMENT ||
+      seg_result.seg_mask == nullptr || mask_format_ == MaskFormat::NONE) {
+    return;
+  }
+  if (mask_format_ == MaskFormat::RLE) {
+    auto counts = encode_mask_rle(seg_result.seg_mask, seg_result.width,
+                                  seg_result.height);
+    output_ << ",\"mask\":{\"size\":[" << seg_result.width << ","
+            << seg_result.height << "],\"counts\":[";
+    for (size_t i = 0; i < counts.size(); ++i) {
+      output_ << (i == 0 ? "" : ",") << counts[i];
+    }
+    output_ << "]}";
+    return;
+  }
+  const auto &box = od_results.results[index].box;
+  auto polygons =
+      encode_mask_polygons(seg_result.seg_mask, seg_result.width,
+                           seg_result.height, cv::Point(box.left, box.top));
+  output_ << ",\"polygons\":[";
+  for (size_t i = 0; i < polygons.size(); ++i) {
+    output_ << (i == 0 ? "[" : ",[");
+    for (size_t j = 0; j < polygons[i].size(); ++j) {
+      output_ << (j == 0 ? "" : ",") << polygons[i][j].x << ","
+              << polygons[i][j].y;
+    }
+    output_ << "]";
+  }
+  output_ << "]";
+}
+
+void DetectionSink::WriteBinary(const InferenceResult &result) {
+  const auto &od_results = *result.detections;
+  int32_t stream_id = result.stream_id;
+  uint64_t frame = result.sequence;
+  int32_t count = od_results.count;
+  output_.write(reinterpret_cast<const char *>(&stream_id), sizeof(stream_id));
+  output_.write(reinterpret_cast<const char *>(&frame), sizeof(frame));
+  output_.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  for (int i = 0; i < count; ++i) {
+    int32_t cls_id;
+    float prop;
+    int32_t box[4];
+    float theta = 0.0f;
+    if (od_results.model_type == ModelType::OBB) {
+      auto &obb = od_results.results_obb[i];
+      cls_id = obb.cls_id;
+      prop = obb.prop;
+      box[0] = obb.box.x;
+      box[1] = obb.box.y;
+      box[2] = obb.box.w;
+      box[3] = obb.box.h;
+      theta = obb.box.theta;
+    } else {
+      auto &det = od_results.results[i];
+      cls_id = det.cls_id;
+      prop = det.prop;
+      box[0] = det.box.left;
+      box[1] = det.box.top;
+      box[2] = det.box.right;
+      box[3] = det.box.bottom;
+    }
+    output_.write(reinterpret_cast<const char *>(&cls_id), sizeof(cls_id));
+    output_.write(reinterpret_cast<const char *>(&prop), sizeof(prop));
+    output_.write(reinterpret_cast<const char *>(box), sizeof(box));
+    output_.write(reinterpret_cast<const char *>(&theta), sizeof(theta));
+  }
+}
+
+DetectionSink::Format get_detection_format(const std::string &filename) {
+  const std::string extension = ".bin";
+  if (filename.size() >= extension.size() &&
+      filename.compare(filename.size() - extension.size(), extension.size(),
+                       extension) == 0) {
+    return DetectionSink::Format::BINARY;
+  }
+  return DetectionSink::Format::JSON_LINES;
+}
+
+bool parse_mask_format(const std::string &str,
+                       DetectionSink::MaskFormat *mask_format) {
+  if (str == "rle") {
+    *mask_format = DetectionSink::MaskFormat::RLE;
+  } else if (str == "polygon") {
+    *mask_format = DetectionSink::MaskFormat::POLYGON;
+  } else if (str == "none") {
+    *mask_format = DetectionSink::MaskFormat::NONE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+DisplaySink::DisplaySink(const std::string &window_name, size_t stream_num)
+    : ResultSink(stream_num, true), window_name_(window_name) {
+  Start();
+}
+
+DisplaySink::~DisplaySink() { Stop(); }
+
+void DisplaySink::Consume(const InferenceResult &result) {
+  if (result.image == nullptr || result.stream_id < 0) {
+    return;
+  }
+  if (windows_.size() <= static_cast<size_t>(result.stream_id)) {
+    windows_.resize(result.stream_id + 1);
+  }
+  std::string &window = windows_[result.stream_id];
+  if (window.empty()) {
+    window = result.stream_id == 0
+                 ? window_name_
+                 : window_name_ + " " + std::to_string(result.stream_id);
+    cv::namedWindow(window, cv::WINDOW_AUTOSIZE);
+  }
+  cv::imshow(window, *result.image);
+  cv::waitKey(1);
+}
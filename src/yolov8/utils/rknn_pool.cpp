@@ -5,13 +5,19 @@
 #include "rknn_pool.h"
 
 #include "kaylordut/log/logger.h"
+#include "kaylordut/time/time_duration.h"
 #include "postprocess.h"
 
 RknnPool::RknnPool(const std::string model_path, const int thread_num,
-                   const std::string lable_path) {
+                   const std::string lable_path,
+                   const std::vector<rknn_core_mask> core_masks) {
   this->thread_num_ = thread_num;
   this->model_path_ = model_path;
   this->label_path_ = lable_path;
+  this->core_masks_ = core_masks;
+  if (this->core_masks_.empty()) {
+    this->core_masks_ = {RKNN_NPU_CORE_0, RKNN_NPU_CORE_1, RKNN_NPU_CORE_2};
+  }
   this->Init();
 }
 
@@ -22,6 +28,7 @@ void RknnPool::Init() {
   try {
     // 配置线程池
     this->pool_ = std::make_unique<ThreadPool>(this->thread_num_);
+    this->scheduler_ = std::make_unique<NpuScheduler>(this->thread_num_);
     // 这里每一个线程需要加载一个模型
     for (int i = 0; i < this->thread_num_; ++i) {
       models_.push_back(std::make_shared<Yolov8>(
@@ -31,58 +38,337 @@ void RknnPool::Init() {
     KAYLORDUT_LOG_ERROR("Out of memory: {}", e.what());
     exit(EXIT_FAILURE);
   }
-  for (int i = 0; i < this->thread_num_; ++i) {
-    auto ret = models_[i]->Init(models_[0]->get_rknn_context(), i != 0);
+  // 整个推理池只映射一次模型文件，只有第一个上下文需要读取它
+  init_time_ = std::chrono::steady_clock::now();
+  {
+    ModelFile model_file(this->model_path_);
+    auto ret = models_[0]->Init(nullptr, false, core_masks_[0], &model_file);
     if (ret != 0) {
       KAYLORDUT_LOG_ERROR("Init rknn model failed!");
       exit(EXIT_FAILURE);
     }
   }
+  // 其余上下文从第一个上下文复制，互不依赖，放到线程池里并行创建
+  std::vector<std::future<int>> results;
+  for (int i = 1; i < this->thread_num_; ++i) {
+    results.push_back(pool_->enqueue(
+        [this](int i) {
+          return models_[i]->Init(models_[0]->get_rknn_context(), true,
+                                  core_masks_[i % core_masks_.size()]);
+        },
+        i));
+  }
+  for (auto &result : results) {
+    if (result.get() != 0) {
+      KAYLORDUT_LOG_ERROR("Init rknn model failed!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  KAYLORDUT_LOG_INFO(
+      "{} rknn contexts are ready in {}ms", this->thread_num_,
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - init_time_)
+          .count());
+  max_batch_ = models_[0]->get_batch_size();
+  if (max_batch_ > 1) {
+    KAYLORDUT_LOG_INFO("model batch size is {}, enable dynamic batching",
+                       max_batch_);
+    batch_thread_ = std::thread(&RknnPool::BatchLoop, this);
+  }
+}
+
+void RknnPool::DeInit() {
+  if (batch_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      stop_ = true;
+    }
+    pending_condition_.notify_all();
+    batch_thread_.join();
+  }
+  // 等待所有任务完成之后再释放标签
+  pool_.reset();
+  deinit_post_process();
+}
+
+void RknnPool::SetBatchPolicy(int max_batch,
+                              std::chrono::microseconds max_wait) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  max_batch_ = std::max(1, std::min(max_batch, models_[0]->get_batch_size()));
+  max_batch_wait_ = max_wait;
+  pending_condition_.notify_all();
 }
 
-void RknnPool::DeInit() { deinit_post_process(); }
+void RknnPool::SetPreNmsTopK(int top_k) {
+  for (auto &model : models_) {
+    model->set_pre_nms_top_k(top_k);
+  }
+}
 
-void RknnPool::AddInferenceTask(std::shared_ptr<cv::Mat> src,
-                                ImageProcess &image_process) {
-  pool_->enqueue(
-      [&](std::shared_ptr<cv::Mat> original_img) {
-        auto convert_img = image_process.Convert(*original_img);
-        auto mode_id = get_model_id();
-        cv::Mat rgb_img = cv::Mat::zeros(
-            this->models_[mode_id]->get_model_width(),
-            this->models_[mode_id]->get_model_height(), convert_img->type());
-        cv::cvtColor(*convert_img, rgb_img, cv::COLOR_BGR2RGB);
-        object_detect_result_list od_results;
-        this->models_[mode_id]->Inference(rgb_img.ptr(), &od_results,
-                                          image_process.get_letter_box());
-        image_process.ImagePostProcess(*original_img, od_results);
-        std::lock_guard<std::mutex> lock_guard(this->image_results_mutex_);
-        this->image_results_.push(std::move(original_img));
-      },
-      std::move(src));
+bool RknnPool::SetParallelPostProcess(bool enable) {
+  // 先让推理线程不再使用旧的辅助线程池，之后才能释放或者重新创建
+  for (auto &model : models_) {
+    model->set_decode_pool(nullptr);
+  }
+  decode_pool_.reset();
+  if (!enable) {
+    return true;
+  }
+  // 每一级流水线占用一个推理线程，剩下的核心才用于并行解码
+  int infer_num = thread_num_ * pipeline_depth_;
+  int helper_num =
+      static_cast<int>(std::thread::hardware_concurrency()) - infer_num;
+  if (helper_num <= 0) {
+    KAYLORDUT_LOG_WARN(
+        "{} cpu cores are not more than {} inference threads, parallel post "
+        "process is disabled",
+        std::thread::hardware_concurrency(), infer_num);
+    return false;
+  }
+  decode_pool_ = std::make_unique<ThreadPool>(helper_num);
+  for (auto &model : models_) {
+    model->set_decode_pool(decode_pool_.get());
+  }
+  KAYLORDUT_LOG_INFO("parallel post process with {} helper threads",
+                     helper_num);
+  return true;
+}
+
+bool RknnPool::SetPipelineDepth(int depth) {
+  depth = std::max(1, depth);
+  // 等待已经提交的任务完成，之后才能重新分配每个上下文的缓冲区
+  pool_.reset();
+  bool ok = true;
+  for (auto &model : models_) {
+    if (!model->SetPipelineDepth(depth)) {
+      KAYLORDUT_LOG_ERROR("Set pipeline depth {} failed", depth);
+      ok = false;
+      break;
+    }
+  }
+  if (!ok) {
+    depth = 1;
+    for (auto &model : models_) {
+      if (!model->SetPipelineDepth(depth)) {
+        KAYLORDUT_LOG_ERROR("Init rknn model failed!");
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  // 每一级需要一个推理线程，调度器允许每个上下文有depth帧在途
+  pipeline_depth_ = depth;
+  pool_ = std::make_unique<ThreadPool>(thread_num_ * depth);
+  scheduler_ = std::make_unique<NpuScheduler>(thread_num_, depth);
+  // 推理线程变多了，按剩下的核心重新分配并行解码的辅助线程
+  if (decode_pool_ != nullptr) {
+    SetParallelPostProcess(true);
+  }
+  KAYLORDUT_LOG_INFO("{} rknn contexts with pipeline depth {}", thread_num_,
+                     depth);
+  return ok;
+}
+
+int RknnPool::AddStream(int width, int height, bool is_track, int framerate,
+                        int weight, int max_pending,
+                        std::chrono::milliseconds reorder_timeout,
+                        bool render) {
+  return streams_.AddStream(width, height, models_[0]->get_model_width(),
+                            is_track, framerate, weight, max_pending,
+                            reorder_timeout, render);
+}
+
+void RknnPool::AddInferenceTask(int stream_id, std::shared_ptr<cv::Mat> src) {
+  if (streams_.Push(stream_id, std::move(src))) {
+    ScheduleTask();
+  }
 }
 
-int RknnPool::get_model_id() {
-  std::lock_guard<std::mutex> lock(id_mutex_);
-  int mode_id = id;
-  id++;
-  if (id == thread_num_) {
-    id = 0;
+void RknnPool::AddInferenceTask(int stream_id, std::shared_ptr<cv::Mat> src,
+                                uint64_t sequence) {
+  if (streams_.Push(stream_id, std::move(src), nullptr, sequence)) {
+    ScheduleTask();
   }
-  //  KAYLORDUT_LOG_INFO("id = {}, num = {}, mode id = {}", id, thread_num_,
-  //  mode_id);
-  return mode_id;
 }
 
-std::shared_ptr<cv::Mat> RknnPool::GetImageResultFromQueue() {
-  std::lock_guard<std::mutex> lock_guard(this->image_results_mutex_);
-  if (this->image_results_.empty()) {
-    return nullptr;
-  } else {
-    auto res = this->image_results_.front();
-    this->image_results_.pop();
-    return std::move(res);
+void RknnPool::AddInferenceTask(int stream_id,
+                                std::shared_ptr<RawFrame> frame) {
+  if (streams_.Push(stream_id, nullptr, std::move(frame))) {
+    ScheduleTask();
   }
 }
 
-int RknnPool::GetTasksSize() { return pool_->TasksSize(); }
+void RknnPool::ScheduleTask() {
+  if (batch_thread_.joinable()) {
+    // 持有锁再通知，避免批处理线程在检查条件之后错过这次通知
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_condition_.notify_all();
+    return;
+  }
+  // 每个任务对应一次执行机会，具体处理哪一路视频由加权轮询决定
+  pool_->enqueue([this] { RunNextTasks(1); });
+}
+
+void RknnPool::RunNextTasks(int max_count) {
+  std::vector<InferenceTask> tasks;
+  if (streams_.Pop(max_count, &tasks) > 0) {
+    RunTasks(std::move(tasks));
+  }
+}
+
+void RknnPool::BatchLoop() {
+  std::unique_lock<std::mutex> lock(pending_mutex_);
+  while (true) {
+    std::chrono::steady_clock::time_point oldest;
+    if (!streams_.GetOldestEnqueueTime(&oldest)) {
+      if (stop_) {
+        return;
+      }
+      pending_condition_.wait(
+          lock, [this] { return stop_ || streams_.PendingSize() > 0; });
+      continue;
+    }
+    auto deadline = oldest + max_batch_wait_;
+    if (!stop_ && streams_.PendingSize() < max_batch_ &&
+        std::chrono::steady_clock::now() < deadline) {
+      pending_condition_.wait_until(lock, deadline, [this] {
+        return stop_ || streams_.PendingSize() >= max_batch_;
+      });
+      continue;
+    }
+    std::vector<InferenceTask> tasks;
+    streams_.Pop(max_batch_, &tasks);
+    lock.unlock();
+    pool_->enqueue(
+        [this](std::vector<InferenceTask> tasks) {
+          RunTasks(std::move(tasks));
+        },
+        std::move(tasks));
+    lock.lock();
+  }
+}
+
+void RknnPool::RunTasks(std::vector<InferenceTask> tasks) {
+  // 原始帧在这里解码，解码之后立即归还采集缓冲区
+  // YUV帧保留原始数据，获取上下文之后一次转换到模型输入，解码的图像只用于绘制
+  TimeDuration preprocess_time;
+  for (auto it = tasks.begin(); it != tasks.end();) {
+    // 不绘制的YUV帧不需要BGR图像，直接转换到模型输入
+    if (it->image == nullptr &&
+        (it->render || !is_yuv_format(it->raw_frame->fourcc))) {
+      it->image = DecodeRawFrame(*it->raw_frame,
+                                 it->image_process->get_resized_size());
+      if (!is_yuv_format(it->raw_frame->fourcc)) {
+        it->raw_frame.reset();
+      }
+      if (it->image == nullptr) {
+        streams_.SkipResult(it->stream_id, it->sequence);
+        it = tasks.erase(it);
+        continue;
+      }
+    }
+    // 保留的YUV帧在获取上下文之后才转换，大小不对的帧现在就丢弃
+    if (it->raw_frame != nullptr &&
+        !it->image_process->CheckYuvFrame(*it->raw_frame)) {
+      streams_.SkipResult(it->stream_id, it->sequence);
+      it = tasks.erase(it);
+      continue;
+    }
+    ++it;
+  }
+  if (tasks.empty()) {
+    return;
+  }
+  int count = tasks.size();
+  std::vector<std::shared_ptr<cv::Mat>> convert_imgs(count);
+  std::vector<letterbox_t> letter_boxes(count);
+  for (int i = 0; i < count; ++i) {
+    if (tasks[i].raw_frame == nullptr) {
+      convert_imgs[i] = tasks[i].image_process->Convert(*tasks[i].image);
+      // 不绘制时原图已经没有用处，马上归还给帧池（或者采集缓冲区）
+      if (!tasks[i].render) {
+        tasks[i].image.reset();
+      }
+    }
+    letter_boxes[i] = tasks[i].image_process->get_letter_box();
+  }
+  auto preprocess_cost = preprocess_time.DurationSinceLastTime();
+  // 选择负载最低的空闲上下文，推理结束后归还
+  // 流水线模式下同一个上下文可能分给多个任务，每个任务占用其中的一级
+  auto mode_id = scheduler_->Acquire();
+  auto &model = this->models_[mode_id];
+  int slot = model->AcquireSlot();
+  preprocess_time.DurationSinceLastTime();
+  // 转换失败的图片仍然占着batch中的位置，推理之后丢弃它的结果
+  std::vector<bool> converted(count, true);
+  for (int i = 0; i < count; ++i) {
+    if (tasks[i].raw_frame != nullptr) {
+      // 颜色转换、缩放和填充一次完成，没有中间的BGR图像
+      converted[i] = tasks[i].image_process->ConvertYuv(
+          *tasks[i].raw_frame, model->get_input_buffer(i, slot));
+      tasks[i].raw_frame.reset();
+      continue;
+    }
+    // 直接转换到模型的输入缓冲区，batch模型按顺序排列
+    cv::Mat rgb_img(model->get_model_height(), model->get_model_width(),
+                    convert_imgs[i]->type(),
+                    model->get_input_buffer(i, slot));
+    cv::cvtColor(*convert_imgs[i], rgb_img, cv::COLOR_BGR2RGB);
+    convert_imgs[i].reset();
+  }
+  preprocess_cost += preprocess_time.DurationSinceLastTime();
+  KAYLORDUT_LOG_DEBUG(
+      "preprocess {} frames cost {}us", count,
+      std::chrono::duration_cast<std::chrono::microseconds>(preprocess_cost)
+          .count());
+  std::vector<object_detect_result_list> od_results(count);
+  model->InferenceBatch(count, od_results.data(), letter_boxes.data(), slot);
+  auto run_time = model->get_last_run_time(slot);
+  model->ReleaseSlot(slot);
+  scheduler_->Release(mode_id, run_time);
+  std::call_once(first_inference_flag_, [this] {
+    KAYLORDUT_LOG_INFO(
+        "time to first inference is {}ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - init_time_)
+            .count());
+  });
+  for (int i = 0; i < count; ++i) {
+    if (!converted[i]) {
+      release_seg_masks(&od_results[i]);
+      streams_.SkipResult(tasks[i].stream_id, tasks[i].sequence);
+      continue;
+    }
+    if (tasks[i].render) {
+      tasks[i].image_process->ImagePostProcess(*tasks[i].image, od_results[i]);
+    }
+    auto result = std::make_shared<InferenceResult>();
+    result->stream_id = tasks[i].stream_id;
+    result->sequence = tasks[i].sequence;
+    result->image = std::move(tasks[i].image);
+    // 实例掩码跟随检测结果，最后一个使用者释放结果时一起释放
+    result->detections = std::shared_ptr<object_detect_result_list>(
+        new object_detect_result_list(od_results[i]),
+        [](object_detect_result_list *detections) {
+          release_seg_masks(detections);
+          delete detections;
+        });
+    result->enqueue_time = tasks[i].enqueue_time;
+    streams_.PushResult(std::move(result));
+  }
+}
+
+std::shared_ptr<InferenceResult> RknnPool::GetResultFromQueue(int stream_id) {
+  return streams_.PopResult(stream_id);
+}
+
+StreamStats RknnPool::GetStreamStats(int stream_id) {
+  return streams_.GetStats(stream_id);
+}
+
+int RknnPool::GetTasksSize() {
+  // 非batch模式下线程池里的任务和排队的图片一一对应，只统计排队的图片
+  if (batch_thread_.joinable()) {
+    return pool_->TasksSize() + streams_.PendingSize();
+  }
+  return streams_.PendingSize();
+}
@@ -0,0 +1,127 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "segmented_video.h"
+
+#include "frame_pool.h"
+#include "kaylordut/log/logger.h"
+#include "limits"
+
+SegmentedVideo::SegmentedVideo(const std::string &filename, int decoder_num,
+                               int chunk_frames, int window)
+    : filename_(filename),
+      decoder_num_(std::max(1, decoder_num)),
+      chunk_frames_(std::max(1, chunk_frames)),
+      window_(std::max(1, window)),
+      end_index_(std::numeric_limits<uint64_t>::max()) {
+  cv::VideoCapture capture(filename_);
+  if (!capture.isOpened()) {
+    KAYLORDUT_LOG_ERROR("Error opening video file");
+    exit(EXIT_FAILURE);
+  }
+  width_ = capture.get(cv::CAP_PROP_FRAME_WIDTH);
+  height_ = capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+  fps_ = capture.get(cv::CAP_PROP_FPS);
+  double frame_count = capture.get(cv::CAP_PROP_FRAME_COUNT);
+  if (frame_count <= 0) {
+    // 不知道总帧数时无法分段，退化成一个解码线程顺序读取
+    KAYLORDUT_LOG_WARN("Unknown frame count, decode {} sequentially",
+                       filename_);
+    decoder_num_ = 1;
+    chunk_frames_ = std::numeric_limits<uint64_t>::max();
+    frame_count_ = std::numeric_limits<uint64_t>::max();
+  } else {
+    frame_count_ = static_cast<uint64_t>(frame_count);
+  }
+  KAYLORDUT_LOG_INFO(
+      "{}: {}x{}, {}fps, about {} frames, {} decoders, {} frames per chunk",
+      filename_, width_, height_, fps_, frame_count_, decoder_num_,
+      chunk_frames_);
+}
+
+SegmentedVideo::~SegmentedVideo() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void SegmentedVideo::Start(FrameCallback callback) {
+  callback_ = std::move(callback);
+  running_ = decoder_num_;
+  for (int i = 0; i < decoder_num_; ++i) {
+    threads_.emplace_back(&SegmentedVideo::DecodeLoop, this, i);
+  }
+}
+
+void SegmentedVideo::DecodeLoop(int decoder_id) {
+  cv::VideoCapture capture(filename_);
+  // 第decoder_id、decoder_id + decoder_num、...段由这个线程解码
+  for (uint64_t chunk = decoder_id;; chunk += decoder_num_) {
+    uint64_t start = chunk * chunk_frames_;
+    uint64_t end = std::min(frame_count_, start + chunk_frames_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stop_ || start >= std::min(frame_count_, end_index_)) {
+        break;
+      }
+    }
+    if (start > 0 && !capture.set(cv::CAP_PROP_POS_FRAMES, start)) {
+      KAYLORDUT_LOG_WARN("decoder {} seek to frame {} failed", decoder_id,
+                         start);
+    }
+    for (uint64_t index = start; index < end; ++index) {
+      {
+        // 背压：只能领先已经消费的位置window帧
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this, index] {
+          return stop_ || index >= end_index_ || index < consumed_ + window_;
+        });
+        if (stop_ || index >= end_index_) {
+          break;
+        }
+      }
+      auto frame = FramePool::GetInstance().Acquire(height_, width_, CV_8UC3);
+      capture >> *frame;
+      if (frame->empty()) {
+        // 文件头的帧数可能偏大，以实际读到的位置为准
+        std::lock_guard<std::mutex> lock(mutex_);
+        end_index_ = std::min(end_index_, index);
+        condition_.notify_all();
+        break;
+      }
+      callback_(index, std::move(frame));
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_--;
+  condition_.notify_all();
+}
+
+void SegmentedVideo::Consume(uint64_t index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    consumed_ = std::max(consumed_, index + 1);
+  }
+  condition_.notify_all();
+}
+
+bool SegmentedVideo::IsFinished(uint64_t *frame_count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_ > 0) {
+    return false;
+  }
+  *frame_count = std::min(frame_count_, end_index_);
+  return true;
+}
+
+int SegmentedVideo::get_frame_width() { return width_; }
+
+int SegmentedVideo::get_frame_height() { return height_; }
+
+double SegmentedVideo::get_fps() { return fps_; }
@@ -0,0 +1,200 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "stream_registry.h"
+
+#include "kaylordut/log/logger.h"
+
+// 统计数据中新样本所占的权重
+static const double kStatsWeight = 0.1;
+
+int StreamRegistry::AddStream(int width, int height, int target_size,
+                              bool is_track, int framerate, int weight,
+                              int max_pending,
+                              std::chrono::milliseconds reorder_timeout,
+                              bool render) {
+  auto stream = std::make_unique<Stream>();
+  stream->image_process =
+      std::make_unique<ImageProcess>(width, height, target_size, is_track);
+  stream->weight = std::max(1, weight);
+  stream->max_pending = std::max(0, max_pending);
+  stream->render = render;
+  Stream *stream_ptr = stream.get();
+  stream->tracking_stage = std::make_unique<TrackingStage>(
+      stream->image_process.get(), is_track, framerate,
+      [this, stream_ptr](std::shared_ptr<InferenceResult> result) {
+        DeliverResult(stream_ptr, std::move(result));
+      },
+      reorder_timeout);
+  std::lock_guard<std::mutex> lock(mutex_);
+  streams_.push_back(std::move(stream));
+  int stream_id = streams_.size() - 1;
+  KAYLORDUT_LOG_INFO(
+      "add stream {}: {}x{}, weight = {}, max pending = {}, render = {}",
+      stream_id, width, height, weight, max_pending, render);
+  return stream_id;
+}
+
+int StreamRegistry::get_stream_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return streams_.size();
+}
+
+StreamRegistry::Stream *StreamRegistry::GetStream(int stream_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stream_id < 0 || stream_id >= static_cast<int>(streams_.size())) {
+    return nullptr;
+  }
+  return streams_[stream_id].get();
+}
+
+ImageProcess *StreamRegistry::get_image_process(int stream_id) {
+  auto stream = GetStream(stream_id);
+  return stream == nullptr ? nullptr : stream->image_process.get();
+}
+
+bool StreamRegistry::Push(int stream_id, std::shared_ptr<cv::Mat> image,
+                          std::shared_ptr<RawFrame> raw_frame,
+                          int64_t sequence) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stream_id < 0 || stream_id >= static_cast<int>(streams_.size())) {
+    KAYLORDUT_LOG_ERROR("Invalid stream id {}", stream_id);
+    return false;
+  }
+  Stream &stream = *streams_[stream_id];
+  if (stream.max_pending > 0 &&
+      static_cast<int>(stream.pending.size()) >= stream.max_pending) {
+    stream.tracking_stage->Skip(stream.pending.front().sequence);
+    stream.pending.pop_front();
+    stream.dropped++;
+    pending_size_--;
+  }
+  if (sequence < 0) {
+    sequence = stream.next_sequence++;
+  }
+  // 原始帧从采集设备出队的时间作为入队时间，延时包括采集线程中的耗时
+  auto enqueue_time = raw_frame != nullptr ? raw_frame->timestamp
+                                           : std::chrono::steady_clock::now();
+  stream.pending.push_back(InferenceTask{stream_id,
+                                         static_cast<uint64_t>(sequence),
+                                         std::move(image),
+                                         stream.image_process.get(),
+                                         enqueue_time,
+                                         std::move(raw_frame),
+                                         stream.render});
+  pending_size_++;
+  return true;
+}
+
+int StreamRegistry::Pop(int max_count, std::vector<InferenceTask> *tasks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int count = 0;
+  while (count < max_count && pending_size_ > 0) {
+    // 平滑加权轮询：只在有任务排队的视频流之间分配
+    Stream *selected = nullptr;
+    int total_weight = 0;
+    for (auto &stream : streams_) {
+      if (stream->pending.empty()) {
+        continue;
+      }
+      stream->current_weight += stream->weight;
+      total_weight += stream->weight;
+      if (selected == nullptr ||
+          stream->current_weight > selected->current_weight) {
+        selected = stream.get();
+      }
+    }
+    selected->current_weight -= total_weight;
+    tasks->push_back(std::move(selected->pending.front()));
+    selected->pending.pop_front();
+    pending_size_--;
+    count++;
+  }
+  return count;
+}
+
+int StreamRegistry::PendingSize() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_size_;
+}
+
+bool StreamRegistry::GetOldestEnqueueTime(
+    std::chrono::steady_clock::time_point *time) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool found = false;
+  for (auto &stream : streams_) {
+    if (!stream->pending.empty() &&
+        (!found || stream->pending.front().enqueue_time < *time)) {
+      *time = stream->pending.front().enqueue_time;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void StreamRegistry::PushResult(std::shared_ptr<InferenceResult> result) {
+  auto stream = GetStream(result->stream_id);
+  stream->tracking_stage->Push(std::move(result));
+}
+
+void StreamRegistry::SkipResult(int stream_id, uint64_t sequence) {
+  auto stream = GetStream(stream_id);
+  stream->tracking_stage->Skip(sequence);
+}
+
+void StreamRegistry::DeliverResult(Stream *stream,
+                                   std::shared_ptr<InferenceResult> result) {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(stream->results_mutex);
+  StreamStats &stats = stream->stats;
+  double latency_ms =
+      std::chrono::duration<double, std::milli>(now - result->enqueue_time)
+          .count();
+  if (stats.frames == 0) {
+    stats.latency_ms = latency_ms;
+  } else {
+    stats.latency_ms =
+        stats.latency_ms * (1.0 - kStatsWeight) + latency_ms * kStatsWeight;
+    double interval =
+        std::chrono::duration<double>(now - stream->last_result_time).count();
+    if (interval > 0) {
+      stats.fps = stats.fps == 0.0 ? 1.0 / interval
+                                   : stats.fps * (1.0 - kStatsWeight) +
+                                         kStatsWeight / interval;
+    }
+  }
+  stats.frames++;
+  stream->last_result_time = now;
+  stream->results.push(std::move(result));
+}
+
+std::shared_ptr<InferenceResult> StreamRegistry::PopResult(int stream_id) {
+  auto stream = GetStream(stream_id);
+  if (stream == nullptr) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(stream->results_mutex);
+  if (stream->results.empty()) {
+    return nullptr;
+  }
+  auto res = std::move(stream->results.front());
+  stream->results.pop();
+  return res;
+}
+
+StreamStats StreamRegistry::GetStats(int stream_id) {
+  auto stream = GetStream(stream_id);
+  if (stream == nullptr) {
+    return StreamStats{0, 0, 0.0, 0.0};
+  }
+  StreamStats stats;
+  {
+    std::lock_guard<std::mutex> lock(stream->results_mutex);
+    stats = stream->stats;
+  }
+  // dropped在排队时更新，受注册表的锁保护
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.dropped = stream->dropped;
+  return stats;
+}
@@ -0,0 +1,114 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "tracking_stage.h"
+
+#include "kaylordut/log/logger.h"
+
+TrackingStage::TrackingStage(const ImageProcess *image_process, bool is_track,
+                             int framerate, OutputCallback output,
+                             std::chrono::milliseconds reorder_timeout)
+    : image_process_(image_process),
+      is_track_(is_track),
+      output_(std::move(output)),
+      reorder_timeout_(reorder_timeout) {
+  if (is_track_) {
+    tracker_ = std::make_unique<BYTETracker>(framerate, 30);
+  }
+  thread_ = std::thread(&TrackingStage::Loop, this);
+}
+
+TrackingStage::~TrackingStage() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  thread_.join();
+}
+
+void TrackingStage::Push(std::shared_ptr<InferenceResult> result) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (result->sequence >= next_sequence_) {
+      reorder_[result->sequence] = std::move(result);
+    }
+  }
+  if (result != nullptr) {
+    // 已经超时跳过的帧，不再参与跟踪，直接输出
+    KAYLORDUT_LOG_WARN("frame {} arrived too late, skip tracking",
+                       result->sequence);
+    output_(std::move(result));
+    return;
+  }
+  condition_.notify_one();
+}
+
+void TrackingStage::Skip(uint64_t sequence) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sequence < next_sequence_) {
+      return;
+    }
+    reorder_[sequence] = nullptr;
+  }
+  condition_.notify_one();
+}
+
+void TrackingStage::Loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (!reorder_.empty() &&
+        (reorder_.begin()->first == next_sequence_ || stop_)) {
+      // 退出时不再等待缺失的帧，剩下的结果按顺序输出
+      auto it = reorder_.begin();
+      auto result = std::move(it->second);
+      next_sequence_ = it->first + 1;
+      reorder_.erase(it);
+      lock.unlock();
+      Process(std::move(result));
+      lock.lock();
+      continue;
+    }
+    if (stop_) {
+      return;
+    }
+    if (reorder_.empty()) {
+      condition_.wait(lock, [this] { return stop_ || !reorder_.empty(); });
+      continue;
+    }
+    // 后面的帧已经到达，等待缺失的帧，超时则当作跳过
+    if (reorder_timeout_.count() == 0) {
+      condition_.wait(lock, [this] {
+        return stop_ || reorder_.begin()->first == next_sequence_;
+      });
+      continue;
+    }
+    bool arrived = condition_.wait_for(lock, reorder_timeout_, [this] {
+      return stop_ || reorder_.begin()->first == next_sequence_;
+    });
+    if (!arrived) {
+      KAYLORDUT_LOG_WARN("frame {} timeout, predict tracks without it",
+                         next_sequence_);
+      reorder_[next_sequence_] = nullptr;
+    }
+  }
+}
+
+void TrackingStage::Process(std::shared_ptr<InferenceResult> result) {
+  if (result == nullptr) {
+    // 没有检测结果，轨迹做卡尔曼预测并计入丢失的帧数
+    if (is_track_) {
+      tracker_->update(std::vector<Object>());
+    }
+    return;
+  }
+  if (is_track_ && (result->detections->model_type == ModelType::DETECTION ||
+                    result->detections->model_type ==
+                        ModelType::V10_DETECTION)) {
+    image_process_->ProcessTrackImage(result->image.get(),
+                                      *result->detections, *tracker_);
+  }
+  output_(std::move(result));
+}
@@ -0,0 +1,349 @@
+//
+// Created by kaylor on 10/19/26.
+//
+
+#include "v4l2_camera.h"
+
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cstring"
+#include "fstream"
+#include "kaylordut/log/logger.h"
+
+struct V4l2Camera::Device {
+  struct Buffer {
+    uint8_t *data;
+    size_t length;
+  };
+  int fd{-1};
+  bool fake{false};
+  bool streaming{false};
+  uint32_t fourcc{0};
+  std::vector<Buffer> buffers;
+  // 模拟模式：整个文件读到内存，按帧切分，缓冲区用普通内存代替
+  std::vector<uint8_t> file_data;
+  std::vector<std::pair<size_t, size_t>> fake_frames;  // 偏移和长度
+  size_t fake_next{0};
+  std::vector<std::vector<uint8_t>> fake_storage;
+  std::vector<int> free_buffers;
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  // 帧释放时调用，把缓冲区重新交给驱动（或者模拟设备）
+  void Requeue(int index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fake) {
+      free_buffers.push_back(index);
+      condition.notify_one();
+      return;
+    }
+    if (!streaming) {
+      return;
+    }
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    if (ioctl(fd, VIDIOC_QBUF, &buf) < 0) {
+      KAYLORDUT_LOG_ERROR("VIDIOC_QBUF {} failed: {}", index, strerror(errno));
+    }
+  }
+
+  ~Device() {
+    if (fd < 0) {
+      return;
+    }
+    for (auto &buffer : buffers) {
+      munmap(buffer.data, buffer.length);
+    }
+    close(fd);
+  }
+};
+
+static int xioctl(int fd, unsigned long request, void *arg) {
+  int ret;
+  do {
+    ret = ioctl(fd, request, arg);
+  } while (ret < 0 && errno == EINTR);
+  return ret;
+}
+
+V4l2Camera::V4l2Camera(const std::string &device, cv::Size size,
+                       double framerate, uint32_t fourcc, int buffer_count)
+    : device_(std::make_shared<Device>()),
+      size_(size),
+      frame_interval_(static_cast<int64_t>(1000000 / framerate)) {
+  KAYLORDUT_LOG_INFO("Instantiate a V4l2Camera object");
+  struct stat st;
+  if (stat(device.c_str(), &st) != 0) {
+    KAYLORDUT_LOG_ERROR("{} does not exist", device);
+    exit(EXIT_FAILURE);
+  }
+  bool ret = S_ISREG(st.st_mode)
+                 ? OpenFakeDevice(device, fourcc, buffer_count)
+                 : OpenDevice(device, framerate, fourcc, buffer_count);
+  if (!ret) {
+    KAYLORDUT_LOG_ERROR("Open {} failed", device);
+    exit(EXIT_FAILURE);
+  }
+  KAYLORDUT_LOG_INFO("{}camera width: {}, height: {}, buffers: {}",
+                     device_->fake ? "fake " : "", size_.width, size_.height,
+                     device_->buffers.size());
+  thread_ = std::thread(&V4l2Camera::CaptureLoop, this);
+}
+
+V4l2Camera::~V4l2Camera() {
+  stop_ = true;
+  condition_.notify_all();
+  device_->condition.notify_all();
+  thread_.join();
+  {
+    std::lock_guard<std::mutex> lock(device_->mutex);
+    if (device_->streaming) {
+      KAYLORDUT_LOG_INFO("Release camera");
+      v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      xioctl(device_->fd, VIDIOC_STREAMOFF, &type);
+      device_->streaming = false;
+    }
+  }
+  // 还在推理中的帧持有device_，缓冲区在它们释放之后才解除映射
+  std::lock_guard<std::mutex> lock(mutex_);
+  latest_.reset();
+}
+
+bool V4l2Camera::OpenDevice(const std::string &device, double framerate,
+                            uint32_t fourcc, int buffer_count) {
+  int fd = open(device.c_str(), O_RDWR | O_NONBLOCK);
+  if (fd < 0) {
+    KAYLORDUT_LOG_ERROR("open {} failed: {}", device, strerror(errno));
+    return false;
+  }
+  device_->fd = fd;
+  v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  fmt.fmt.pix.width = size_.width;
+  fmt.fmt.pix.height = size_.height;
+  fmt.fmt.pix.pixelformat = fourcc;
+  fmt.fmt.pix.field = V4L2_FIELD_ANY;
+  if (xioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
+    KAYLORDUT_LOG_ERROR("VIDIOC_S_FMT failed: {}", strerror(errno));
+    return false;
+  }
+  // 驱动可能调整格式和分辨率，以实际的为准
+  if (fmt.fmt.pix.pixelformat != fourcc) {
+    KAYLORDUT_LOG_WARN("Set video format failed");
+  }
+  device_->fourcc = fmt.fmt.pix.pixelformat;
+  size_ = cv::Size(fmt.fmt.pix.width, fmt.fmt.pix.height);
+  v4l2_streamparm parm;
+  memset(&parm, 0, sizeof(parm));
+  parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  parm.parm.capture.timeperframe.numerator = 1000;
+  parm.parm.capture.timeperframe.denominator =
+      static_cast<uint32_t>(framerate * 1000);
+  if (xioctl(fd, VIDIOC_S_PARM, &parm) < 0) {
+    KAYLORDUT_LOG_WARN("set framerate failed!!");
+  }
+  v4l2_requestbuffers req;
+  memset(&req, 0, sizeof(req));
+  req.count = buffer_count;
+  req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(fd, VIDIOC_REQBUFS, &req) < 0 || req.count == 0) {
+    KAYLORDUT_LOG_ERROR("VIDIOC_REQBUFS failed: {}", strerror(errno));
+    return false;
+  }
+  for (uint32_t i = 0; i < req.count; ++i) {
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = i;
+    if (xioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
+      KAYLORDUT_LOG_ERROR("VIDIOC_QUERYBUF failed: {}", strerror(errno));
+      return false;
+    }
+    void *data = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, buf.m.offset);
+    if (data == MAP_FAILED) {
+      KAYLORDUT_LOG_ERROR("mmap buffer {} failed: {}", i, strerror(errno));
+      return false;
+    }
+    device_->buffers.push_back({static_cast<uint8_t *>(data), buf.length});
+    if (xioctl(fd, VIDIOC_QBUF, &buf) < 0) {
+      KAYLORDUT_LOG_ERROR("VIDIOC_QBUF failed: {}", strerror(errno));
+      return false;
+    }
+  }
+  v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+    KAYLORDUT_LOG_ERROR("VIDIOC_STREAMON failed: {}", strerror(errno));
+    return false;
+  }
+  device_->streaming = true;
+  return true;
+}
+
+bool V4l2Camera::OpenFakeDevice(const std::string &device, uint32_t fourcc,
+                                int buffer_count) {
+  std::ifstream file(device, std::ios::binary);
+  device_->file_data.assign(std::istreambuf_iterator<char>(file),
+                            std::istreambuf_iterator<char>());
+  auto &data = device_->file_data;
+  auto &frames = device_->fake_frames;
+  if (fourcc == V4L2_PIX_FMT_MJPEG || fourcc == V4L2_PIX_FMT_JPEG) {
+    // 按照SOI(FFD8)和EOI(FFD9)切分连续的JPEG
+    size_t start = 0;
+    bool in_frame = false;
+    for (size_t i = 0; i + 1 < data.size(); ++i) {
+      if (data[i] != 0xFF) {
+        continue;
+      }
+      if (!in_frame && data[i + 1] == 0xD8) {
+        start = i;
+        in_frame = true;
+      } else if (in_frame && data[i + 1] == 0xD9) {
+        frames.emplace_back(start, i + 2 - start);
+        in_frame = false;
+      }
+    }
+  } else {
+    size_t frame_size = 0;
+    if (fourcc == V4L2_PIX_FMT_YUYV) {
+      frame_size = size_.width * size_.height * 2;
+    } else if (fourcc == V4L2_PIX_FMT_NV12) {
+      frame_size = size_.width * size_.height * 3 / 2;
+    } else {
+      KAYLORDUT_LOG_ERROR("Unsupported pixel format {:#x}", fourcc);
+      return false;
+    }
+    for (size_t offset = 0; offset + frame_size <= data.size();
+         offset += frame_size) {
+      frames.emplace_back(offset, frame_size);
+    }
+  }
+  if (frames.empty()) {
+    KAYLORDUT_LOG_ERROR("No frame in {}", device);
+    return false;
+  }
+  size_t max_size = 0;
+  for (auto &frame : frames) {
+    max_size = std::max(max_size, frame.second);
+  }
+  device_->fake = true;
+  device_->fourcc = fourcc;
+  device_->fake_storage.resize(buffer_count);
+  for (int i = 0; i < buffer_count; ++i) {
+    device_->fake_storage[i].resize(max_size);
+    device_->buffers.push_back({device_->fake_storage[i].data(), max_size});
+    device_->free_buffers.push_back(i);
+  }
+  KAYLORDUT_LOG_INFO("fake device {} has {} frames", device, frames.size());
+  return true;
+}
+
+void V4l2Camera::CaptureLoop() {
+  while (!stop_) {
+    auto frame = device_->fake ? DequeueFake() : Dequeue();
+    if (frame == nullptr) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (latest_ != nullptr) {
+      // 消费者跟不上，丢弃旧帧，缓冲区立即归还
+      dropped_++;
+    }
+    latest_ = std::move(frame);
+    condition_.notify_one();
+  }
+}
+
+std::shared_ptr<RawFrame> V4l2Camera::Dequeue() {
+  pollfd fds{device_->fd, POLLIN, 0};
+  // 超时返回，检查是否需要退出
+  int ret = poll(&fds, 1, 100);
+  if (ret <= 0) {
+    if (ret < 0 && errno != EINTR) {
+      KAYLORDUT_LOG_ERROR("poll failed: {}", strerror(errno));
+    }
+    return nullptr;
+  }
+  v4l2_buffer buf;
+  memset(&buf, 0, sizeof(buf));
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(device_->fd, VIDIOC_DQBUF, &buf) < 0) {
+    if (errno != EAGAIN) {
+      KAYLORDUT_LOG_ERROR("VIDIOC_DQBUF failed: {}", strerror(errno));
+    }
+    return nullptr;
+  }
+  auto timestamp = std::chrono::steady_clock::now();
+  auto device = device_;
+  int index = buf.index;
+  return std::shared_ptr<RawFrame>(
+      new RawFrame{device_->buffers[index].data, buf.bytesused,
+                   device_->fourcc, size_.width, size_.height, timestamp,
+                   sequence_++},
+      [device, index](RawFrame *frame) {
+        device->Requeue(index);
+        delete frame;
+      });
+}
+
+std::shared_ptr<RawFrame> V4l2Camera::DequeueFake() {
+  // 按帧率输出，模拟摄像头的节奏
+  std::this_thread::sleep_until(next_fake_time_);
+  next_fake_time_ = std::max(next_fake_time_ + frame_interval_,
+                             std::chrono::steady_clock::now());
+  int index;
+  {
+    std::unique_lock<std::mutex> lock(device_->mutex);
+    // 所有缓冲区都在下游时，和真实的驱动一样丢掉这一帧
+    if (!device_->condition.wait_for(
+            lock, std::chrono::milliseconds(100),
+            [this] { return stop_ || !device_->free_buffers.empty(); }) ||
+        stop_) {
+      return nullptr;
+    }
+    index = device_->free_buffers.back();
+    device_->free_buffers.pop_back();
+  }
+  auto &frame = device_->fake_frames[device_->fake_next];
+  device_->fake_next = (device_->fake_next + 1) % device_->fake_frames.size();
+  memcpy(device_->buffers[index].data, device_->file_data.data() + frame.first,
+         frame.second);
+  auto timestamp = std::chrono::steady_clock::now();
+  auto device = device_;
+  return std::shared_ptr<RawFrame>(
+      new RawFrame{device_->buffers[index].data, frame.second,
+                   device_->fourcc, size_.width, size_.height, timestamp,
+                   sequence_++},
+      [device, index](RawFrame *frame) {
+        device->Requeue(index);
+        delete frame;
+      });
+}
+
+std::shared_ptr<RawFrame> V4l2Camera::GetNextFrame(
+    std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait_for(lock, timeout,
+                      [this] { return stop_ || latest_ != nullptr; });
+  return std::move(latest_);
+}
+
+cv::Size V4l2Camera::get_size() { return size_; }
+
+uint64_t V4l2Camera::get_dropped() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
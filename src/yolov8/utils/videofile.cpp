@@ -4,18 +4,53 @@
 
 #include "videofile.h"
 
+#include "condition_variable"
+#include "frame_pool.h"
 #include "image_process.h"
 #include "kaylordut/log/logger.h"
+#include "mutex"
+#include "queue"
 
-VideoFile::VideoFile(const std::string &&filename) : filename_(filename) {
+struct VideoFile::FrameRing {
+  std::vector<std::shared_ptr<cv::Mat>> storage;
+  std::vector<cv::Mat *> free_frames;
+  std::queue<cv::Mat *> ready_frames;
+  bool eof{false};
+  bool stop{false};
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  void Recycle(cv::Mat *frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    free_frames.push_back(frame);
+    condition.notify_all();
+  }
+};
+
+VideoFile::VideoFile(const std::string &&filename, int ring_size)
+    : filename_(filename), ring_(std::make_shared<FrameRing>()) {
   capture_ = new cv::VideoCapture(filename_);
   if (!capture_->isOpened()) {
     KAYLORDUT_LOG_ERROR("Error opening video file");
     exit(EXIT_FAILURE);
   }
+  // 按视频的分辨率预先分配，解码时尺寸相同会直接复用内存
+  for (int i = 0; i < std::max(1, ring_size); ++i) {
+    ring_->storage.push_back(FramePool::GetInstance().Acquire(
+        get_frame_height(), get_frame_width(), CV_8UC3));
+    ring_->free_frames.push_back(ring_->storage.back().get());
+  }
 }
 
 VideoFile::~VideoFile() {
+  if (decode_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(ring_->mutex);
+      ring_->stop = true;
+    }
+    ring_->condition.notify_all();
+    decode_thread_.join();
+  }
   if (capture_ != nullptr) {
     KAYLORDUT_LOG_INFO("Release capture")
     capture_->release();
@@ -29,7 +64,7 @@ void VideoFile::Display(const float framerate, const int target_size) {
   cv::Mat frame;
   ImageProcess image_process(capture_->get(cv::CAP_PROP_FRAME_WIDTH),
                              capture_->get(cv::CAP_PROP_FRAME_HEIGHT),
-                             target_size, false, 30);
+                             target_size, false);
   while (true) {
     *capture_ >> frame;
     if (frame.empty()) {
@@ -44,13 +79,56 @@ void VideoFile::Display(const float framerate, const int target_size) {
   cv::destroyAllWindows();
 }
 
-std::unique_ptr<cv::Mat> VideoFile::GetNextFrame() {
-  auto frame = std::make_unique<cv::Mat>();
-  *capture_ >> *frame;
-  if (frame->empty()) {
+void VideoFile::DecodeLoop() {
+  while (true) {
+    cv::Mat *frame;
+    {
+      // 所有的帧都还在下游时等待，形成背压
+      std::unique_lock<std::mutex> lock(ring_->mutex);
+      ring_->condition.wait(lock, [this] {
+        return ring_->stop || !ring_->free_frames.empty();
+      });
+      if (ring_->stop) {
+        return;
+      }
+      frame = ring_->free_frames.back();
+      ring_->free_frames.pop_back();
+    }
+    *capture_ >> *frame;
+    std::lock_guard<std::mutex> lock(ring_->mutex);
+    if (frame->empty()) {
+      ring_->free_frames.push_back(frame);
+      ring_->eof = true;
+      ring_->condition.notify_all();
+      return;
+    }
+    ring_->ready_frames.push(frame);
+    ring_->condition.notify_all();
+  }
+}
+
+std::shared_ptr<cv::Mat> VideoFile::GetNextFrame(
+    std::chrono::milliseconds timeout) {
+  if (!decode_thread_.joinable()) {
+    decode_thread_ = std::thread(&VideoFile::DecodeLoop, this);
+  }
+  std::unique_lock<std::mutex> lock(ring_->mutex);
+  ring_->condition.wait_for(lock, timeout, [this] {
+    return ring_->eof || !ring_->ready_frames.empty();
+  });
+  if (ring_->ready_frames.empty()) {
     return nullptr;
   }
-  return std::move(frame);
+  cv::Mat *frame = ring_->ready_frames.front();
+  ring_->ready_frames.pop();
+  auto ring = ring_;
+  return std::shared_ptr<cv::Mat>(
+      frame, [ring](cv::Mat *frame) { ring->Recycle(frame); });
+}
+
+bool VideoFile::IsEnd() {
+  std::lock_guard<std::mutex> lock(ring_->mutex);
+  return ring_->eof && ring_->ready_frames.empty();
 }
 
 cv::Mat VideoFile::test() {
@@ -8,42 +8,47 @@
 #include "kaylordut/time/time_duration.h"
 #include "postprocess.h"
 
-const int RK3588 = 3;
-
-// 设置模型需要绑定的核心
-// Set the core of the model that needs to be bound
-int get_core_num() {
-  static int core_num = 0;
-  static std::mutex mtx;
-  std::lock_guard<std::mutex> lock(mtx);
-  int temp = core_num % RK3588;
-  core_num++;
-  return temp;
+// 解析核心配置字符串，例如 "0"、"1"、"2"、"0_1"、"0_1_2"、"auto"
+// Parse the core mask of a model, e.g. "0", "0_1", "0_1_2" or "auto"
+bool parse_core_mask(const std::string &str, rknn_core_mask *core_mask) {
+  if (str == "auto") {
+    *core_mask = RKNN_NPU_CORE_AUTO;
+  } else if (str == "0") {
+    *core_mask = RKNN_NPU_CORE_0;
+  } else if (str == "1") {
+    *core_mask = RKNN_NPU_CORE_1;
+  } else if (str == "2") {
+    *core_mask = RKNN_NPU_CORE_2;
+  } else if (str == "0_1") {
+    *core_mask = RKNN_NPU_CORE_0_1;
+  } else if (str == "0_1_2") {
+    *core_mask = RKNN_NPU_CORE_0_1_2;
+  } else {
+    return false;
+  }
+  return true;
 }
 
-int read_data_from_file(const char *path, char **out_data) {
-  FILE *fp = fopen(path, "rb");
-  if (fp == NULL) {
-    KAYLORDUT_LOG_INFO("fopen {} failed!", path);
-    return -1;
-  }
-  fseek(fp, 0, SEEK_END);
-  int file_size = ftell(fp);
-  char *data = (char *)malloc(file_size + 1);
-  data[file_size] = 0;
-  fseek(fp, 0, SEEK_SET);
-  if (file_size != fread(data, 1, file_size, fp)) {
-    KAYLORDUT_LOG_INFO("fread {} failed!", path);
-    free(data);
-    fclose(fp);
-    return -1;
-  }
-  if (fp) {
-    fclose(fp);
+// 逗号分隔，每一项对应一个上下文，例如 "0,1,2" 或者 "0_1_2"
+bool parse_core_masks(const std::string &str,
+                      std::vector<rknn_core_mask> *core_masks) {
+  core_masks->clear();
+  size_t start = 0;
+  while (start <= str.size()) {
+    size_t end = str.find(',', start);
+    if (end == std::string::npos) {
+      end = str.size();
+    }
+    rknn_core_mask core_mask;
+    if (!parse_core_mask(str.substr(start, end - start), &core_mask)) {
+      return false;
+    }
+    core_masks->push_back(core_mask);
+    start = end + 1;
   }
-  *out_data = data;
-  return file_size;
+  return !core_masks->empty();
 }
+
 static void dump_tensor_attr(rknn_tensor_attr *attr) {
   KAYLORDUT_LOG_INFO(
       "index={}, name={}, n_dims={}, dims=[{}, {}, {}, {}], n_elems={}, "
@@ -57,44 +62,37 @@ static void dump_tensor_attr(rknn_tensor_attr *attr) {
 
 Yolov8::Yolov8(std::string &&model_path) : model_path_(model_path) {}
 
-int Yolov8::Init(rknn_context *ctx_in, bool copy_weight) {
-  int model_len = 0;
-  char *model;
+int Yolov8::Init(rknn_context *ctx_in, bool copy_weight,
+                 rknn_core_mask core_mask, const ModelFile *model_file) {
   int ret = 0;
-  model_len = read_data_from_file(model_path_.c_str(), &model);
-  if (model == nullptr) {
-    KAYLORDUT_LOG_ERROR("Load model failed");
-    return -1;
-  }
   if (copy_weight) {
     KAYLORDUT_LOG_INFO("rknn_dup_context() is called");
-    // 复用模型参数
+    // 复用模型参数，不需要再读取模型文件
     ret = rknn_dup_context(ctx_in, &ctx_);
     if (ret != RKNN_SUCC) {
       KAYLORDUT_LOG_ERROR("rknn_dup_context failed! error code = {}", ret);
       return -1;
     }
   } else {
+    // 没有传入共享的映射时自己映射，rknn_init返回后即可解除映射
+    std::unique_ptr<ModelFile> own_model_file;
+    if (model_file == nullptr) {
+      own_model_file = std::make_unique<ModelFile>(model_path_);
+      model_file = own_model_file.get();
+    }
+    if (!model_file->IsValid()) {
+      KAYLORDUT_LOG_ERROR("Load model failed");
+      return -1;
+    }
     KAYLORDUT_LOG_INFO("rknn_init() is called");
-    ret = rknn_init(&ctx_, model, model_len, 0, NULL);
-    free(model);
+    ret = rknn_init(&ctx_, model_file->get_data(), model_file->get_size(), 0,
+                    NULL);
     if (ret != RKNN_SUCC) {
       KAYLORDUT_LOG_ERROR("rknn_init failed! error code = {}", ret);
       return -1;
     }
   }
-  rknn_core_mask core_mask;
-  switch (get_core_num()) {
-    case 0:
-      core_mask = RKNN_NPU_CORE_0;
-      break;
-    case 1:
-      core_mask = RKNN_NPU_CORE_1;
-      break;
-    case 2:
-      core_mask = RKNN_NPU_CORE_2;
-      break;
-  }
+  KAYLORDUT_LOG_INFO("core mask is {}", static_cast<int>(core_mask));
   ret = rknn_set_core_mask(ctx_, core_mask);
   if (ret < 0) {
     KAYLORDUT_LOG_ERROR("rknn_set_core_mask failed! error code = {}", ret);
@@ -181,7 +179,11 @@ int Yolov8::Init(rknn_context *ctx_in, bool copy_weight) {
   } else {
     app_ctx_.is_quant = false;
   }
+  app_ctx_.is_fp16 =
+      !app_ctx_.is_quant && output_attrs[0].type == RKNN_TENSOR_FLOAT16;
   app_ctx_.io_num = io_num;
+  app_ctx_.pre_nms_top_k = PRE_NMS_TOP_K;
+  app_ctx_.decode_pool = nullptr;
   app_ctx_.input_attrs =
       (rknn_tensor_attr *)malloc(io_num.n_input * sizeof(rknn_tensor_attr));
   memcpy(app_ctx_.input_attrs, input_attrs,
@@ -191,6 +193,8 @@ int Yolov8::Init(rknn_context *ctx_in, bool copy_weight) {
   memcpy(app_ctx_.output_attrs, output_attrs,
          io_num.n_output * sizeof(rknn_tensor_attr));
 
+  // 第一维是batch，多路视频可以使用batch为2/4的模型合并推理
+  batch_size_ = input_attrs[0].dims[0] > 0 ? input_attrs[0].dims[0] : 1;
   if (input_attrs[0].fmt == RKNN_TENSOR_NCHW) {
     KAYLORDUT_LOG_INFO("model is NCHW input fmt");
     app_ctx_.model_channel = input_attrs[0].dims[1];
@@ -202,24 +206,41 @@ int Yolov8::Init(rknn_context *ctx_in, bool copy_weight) {
     app_ctx_.model_width = input_attrs[0].dims[2];
     app_ctx_.model_channel = input_attrs[0].dims[3];
   }
-  KAYLORDUT_LOG_INFO("model input height={}, width={}, channel={}",
-                     app_ctx_.model_height, app_ctx_.model_width,
+  KAYLORDUT_LOG_INFO("model input batch={}, height={}, width={}, channel={}",
+                     batch_size_, app_ctx_.model_height, app_ctx_.model_width,
                      app_ctx_.model_channel);
   // 初始化输入输出参数
   inputs_ = std::make_unique<rknn_input[]>(app_ctx_.io_num.n_input);
-  outputs_ = std::make_unique<rknn_output[]>(app_ctx_.io_num.n_output);
   inputs_[0].index = 0;
   inputs_[0].type = RKNN_TENSOR_UINT8;
   inputs_[0].fmt = RKNN_TENSOR_NHWC;
-  inputs_[0].size =
-      app_ctx_.model_width * app_ctx_.model_height * app_ctx_.model_channel;
+  inputs_[0].size = batch_size_ * app_ctx_.model_width *
+                    app_ctx_.model_height * app_ctx_.model_channel;
   inputs_[0].buf = nullptr;
+  // 默认由运行时转换成NCHW，量化模型尽量直接读取NPU的原生布局
+  app_ctx_.output_layouts =
+      (tensor_layout_t *)malloc(io_num.n_output * sizeof(tensor_layout_t));
+  UseNchwOutputs();
+  if ((app_ctx_.is_quant || app_ctx_.is_fp16) && !SetupNativeOutputs()) {
+    KAYLORDUT_LOG_INFO("outputs are converted to NCHW by the runtime");
+  }
+  if (!SetPipelineDepth(1)) {
+    if (native_attrs_.empty()) {
+      return -1;
+    }
+    KAYLORDUT_LOG_INFO("outputs are converted to NCHW by the runtime");
+    UseNchwOutputs();
+    if (!SetPipelineDepth(1)) {
+      return -1;
+    }
+  }
   return 0;
 }
 
 Yolov8::~Yolov8() { DeInit(); }
 
 int Yolov8::DeInit() {
+  ReleaseSlots();
   if (app_ctx_.rknn_ctx != 0) {
     KAYLORDUT_LOG_INFO("rknn_destroy")
     rknn_destroy(app_ctx_.rknn_ctx);
@@ -233,6 +254,9 @@ int Yolov8::DeInit() {
     KAYLORDUT_LOG_INFO("free output_attrs");
     free(app_ctx_.output_attrs);
   }
+  if (app_ctx_.output_layouts != nullptr) {
+    free(app_ctx_.output_layouts);
+  }
   return 0;
 }
 
@@ -240,33 +264,107 @@ rknn_context *Yolov8::get_rknn_context() { return &(this->ctx_); }
 
 int Yolov8::Inference(void *image_buf, object_detect_result_list *od_results,
                       letterbox_t letter_box) {
-  TimeDuration total_duration;
-  inputs_[0].buf = image_buf;
-  int ret = rknn_inputs_set(app_ctx_.rknn_ctx, app_ctx_.io_num.n_input,
-                            inputs_.get());
-  if (ret < 0) {
-    KAYLORDUT_LOG_ERROR("rknn_input_set failed! error code = {}", ret);
-    return -1;
+  if (batch_size_ == 1) {
+    return Run(image_buf, 1, od_results, &letter_box, 0);
   }
-  TimeDuration time_duration;
-  ret = rknn_run(app_ctx_.rknn_ctx, nullptr);
-  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-      time_duration.DurationSinceLastTime());
-  if (ret != RKNN_SUCC) {
-    KAYLORDUT_LOG_ERROR("rknn_run failed, error code = {}", ret);
+  // batch模型的输入长度是batch * w * h * c，单张图片放到第一个位置
+  memcpy(get_input_buffer(0), image_buf, inputs_[0].size / batch_size_);
+  return InferenceBatch(1, od_results, &letter_box);
+}
+
+int Yolov8::InferenceBatch(int count, object_detect_result_list *od_results,
+                           const letterbox_t *letter_boxes, int slot) {
+  if (count <= 0 || count > batch_size_) {
+    KAYLORDUT_LOG_ERROR("Invalid batch count {}, model batch size is {}", count,
+                        batch_size_);
     return -1;
   }
-  for (int i = 0; i < app_ctx_.io_num.n_output; ++i) {
-    outputs_[i].index = i;
-    outputs_[i].want_float = (!app_ctx_.is_quant);
+  return Run(slots_[slot].input_buffer.get(), count, od_results, letter_boxes,
+             slot);
+}
+
+int Yolov8::Run(void *input_buf, int count,
+                object_detect_result_list *od_results,
+                const letterbox_t *letter_boxes, int slot) {
+  TimeDuration total_duration;
+  PipelineSlot &pipeline_slot = slots_[slot];
+  rknn_output *outputs = pipeline_slot.outputs.get();
+  std::chrono::microseconds run_time;
+  {
+    // 只在提交和取回输出的时候占用上下文，后处理的时候另一级可以运行下一帧
+    std::lock_guard<std::mutex> lock(run_lock_);
+    inputs_[0].buf = input_buf;
+    int ret = rknn_inputs_set(app_ctx_.rknn_ctx, app_ctx_.io_num.n_input,
+                              inputs_.get());
+    if (ret < 0) {
+      KAYLORDUT_LOG_ERROR("rknn_input_set failed! error code = {}", ret);
+      return -1;
+    }
+    // 原生布局的输出需要把这一级的内存绑定到输出，NPU直接写入
+    if (!native_attrs_.empty() && bound_slot_ != slot) {
+      for (uint32_t i = 0; i < app_ctx_.io_num.n_output; ++i) {
+        ret = rknn_set_io_mem(app_ctx_.rknn_ctx,
+                              pipeline_slot.output_mems[i], &native_attrs_[i]);
+        if (ret != RKNN_SUCC) {
+          KAYLORDUT_LOG_ERROR("rknn_set_io_mem for output {} failed, ret = {}",
+                              i, ret);
+          bound_slot_ = -1;
+          return -1;
+        }
+      }
+      bound_slot_ = slot;
+    }
+    TimeDuration time_duration;
+    ret = rknn_run(app_ctx_.rknn_ctx, nullptr);
+    run_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        time_duration.DurationSinceLastTime());
+    pipeline_slot.last_run_time = run_time;
+    if (ret != RKNN_SUCC) {
+      KAYLORDUT_LOG_ERROR("rknn_run failed, error code = {}", ret);
+      return -1;
+    }
+    if (native_attrs_.empty()) {
+      // 输出复制到这一级预先分配的内存，下一帧运行时不会覆盖
+      ret = rknn_outputs_get(app_ctx_.rknn_ctx, app_ctx_.io_num.n_output,
+                             outputs, nullptr);
+      if (ret != RKNN_SUCC) {
+        KAYLORDUT_LOG_ERROR("rknn_outputs_get failed, error code = {}", ret);
+        return -1;
+      }
+      rknn_outputs_release(app_ctx_.rknn_ctx, app_ctx_.io_num.n_output,
+                           outputs);
+    } else {
+      // 原生布局的输出由NPU直接写入output_mems，只需要同步CPU的缓存
+      for (auto mem : pipeline_slot.output_mems) {
+        rknn_mem_sync(app_ctx_.rknn_ctx, mem, RKNN_MEMORY_SYNC_FROM_DEVICE);
+      }
+    }
   }
-  outputs_lock_.lock();
-  ret = rknn_outputs_get(app_ctx_.rknn_ctx, app_ctx_.io_num.n_output,
-                         outputs_.get(), nullptr);
-  if (ret != RKNN_SUCC) {
-    KAYLORDUT_LOG_ERROR("rknn_outputs_get failed, error code = {}", ret);
-    return -1;
+  auto duration =
+      std::chrono::duration_cast<std::chrono::milliseconds>(run_time);
+  // 输出张量的第一维是batch，按照图片切分后分别做后处理
+  std::unique_ptr<rknn_output[]> frame_outputs =
+      std::make_unique<rknn_output[]>(app_ctx_.io_num.n_output);
+  for (int b = 0; b < count; ++b) {
+    for (int i = 0; i < app_ctx_.io_num.n_output; ++i) {
+      uint32_t frame_size = outputs[i].size / batch_size_;
+      frame_outputs[i] = outputs[i];
+      frame_outputs[i].buf = (uint8_t *)outputs[i].buf + b * frame_size;
+      frame_outputs[i].size = frame_size;
+    }
+    PostProcess(frame_outputs.get(), letter_boxes[b], &od_results[b]);
   }
+
+  auto total_delta = std::chrono::duration_cast<std::chrono::milliseconds>(
+      total_duration.DurationSinceLastTime());
+  KAYLORDUT_LOG_DEBUG(
+      "Inference time is {}ms and total time is {}ms, batch count is {}",
+      duration.count(), total_delta.count(), count);
+  return 0;
+}
+
+void Yolov8::PostProcess(rknn_output *outputs, letterbox_t letter_box,
+                         object_detect_result_list *od_results) {
   const float nms_threshold = NMS_THRESH;       // 默认的NMS阈值
   const float box_conf_threshold = BOX_THRESH;  // 默认的置信度阈值
   // Post Process
@@ -276,37 +374,190 @@ int Yolov8::Inference(void *image_buf, object_detect_result_list *od_results,
   KAYLORDUT_TIME_COST_INFO(
       "rknn_outputs_post_process",
       if (model_type_ == ModelType::SEGMENT) {
-        post_process_seg(&app_ctx_, outputs_.get(), &letter_box,
-                         box_conf_threshold, nms_threshold, od_results);
-      } else if (model_type_ == ModelType::DETECTION ||
-                 model_type_ == ModelType::V10_DETECTION) {
-        post_process(&app_ctx_, outputs_.get(), &letter_box, box_conf_threshold,
+        post_process_seg(&app_ctx_, outputs, &letter_box, box_conf_threshold,
+                         nms_threshold, od_results);
+      } else if (model_type_ == ModelType::DETECTION) {
+        post_process(&app_ctx_, outputs, &letter_box, box_conf_threshold,
                      nms_threshold, od_results);
+      } else if (model_type_ == ModelType::V10_DETECTION) {
+        post_process_v10_detection(&app_ctx_, outputs, &letter_box,
+                                   box_conf_threshold, od_results);
       } else if (model_type_ == ModelType::OBB) {
-        post_process_obb(&app_ctx_, outputs_.get(), &letter_box,
-                         box_conf_threshold, nms_threshold, od_results);
+        post_process_obb(&app_ctx_, outputs, &letter_box, box_conf_threshold,
+                         nms_threshold, od_results);
       } else if (model_type_ == ModelType::POSE) {
-        post_process_pose(&app_ctx_, outputs_.get(), &letter_box,
-                          box_conf_threshold, nms_threshold, od_results);
+        post_process_pose(&app_ctx_, outputs, &letter_box, box_conf_threshold,
+                          nms_threshold, od_results);
       }
-      /*else if (model_type_ == ModelType::V10_DETECTION) {
-        post_process_v10_detection(&app_ctx_, outputs_.get(), &letter_box,
-      box_conf_threshold, od_results);
-      }*/
   );
   od_results->model_type = model_type_;
-
-  // Remeber to release rknn outputs_
-  rknn_outputs_release(app_ctx_.rknn_ctx, app_ctx_.io_num.n_output,
-                       outputs_.get());
-  outputs_lock_.unlock();
-  auto total_delta = std::chrono::duration_cast<std::chrono::milliseconds>(
-      total_duration.DurationSinceLastTime());
-  KAYLORDUT_LOG_DEBUG("Inference time is {}ms and total time is {}ms",
-                      duration.count(), total_delta.count());
-  return 0;
 }
 
 int Yolov8::get_model_width() { return app_ctx_.model_width; }
 
 int Yolov8::get_model_height() { return app_ctx_.model_height; }
+
+int Yolov8::get_batch_size() { return batch_size_; }
+
+uint8_t *Yolov8::get_input_buffer(int index, int slot) {
+  return slots_[slot].input_buffer.get() +
+         index * (inputs_[0].size / batch_size_);
+}
+
+std::chrono::microseconds Yolov8::get_last_run_time(int slot) {
+  return slots_[slot].last_run_time;
+}
+
+void Yolov8::set_pre_nms_top_k(int top_k) { app_ctx_.pre_nms_top_k = top_k; }
+
+void Yolov8::set_decode_pool(ThreadPool *pool) { app_ctx_.decode_pool = pool; }
+
+bool Yolov8::SetPipelineDepth(int depth) {
+  depth = std::max(1, depth);
+  ReleaseSlots();
+  slots_ = std::vector<PipelineSlot>(depth);
+  for (auto &slot : slots_) {
+    if (!AllocateSlot(&slot)) {
+      ReleaseSlots();
+      return false;
+    }
+  }
+  if (depth > 1) {
+    KAYLORDUT_LOG_INFO("pipeline depth is {}", depth);
+  }
+  return true;
+}
+
+int Yolov8::get_pipeline_depth() { return slots_.size(); }
+
+int Yolov8::AcquireSlot() {
+  std::unique_lock<std::mutex> lock(slots_lock_);
+  int slot = -1;
+  slots_condition_.wait(lock, [&] {
+    for (int i = 0; i < static_cast<int>(slots_.size()); ++i) {
+      if (!slots_[i].busy) {
+        slot = i;
+        return true;
+      }
+    }
+    return false;
+  });
+  slots_[slot].busy = true;
+  return slot;
+}
+
+void Yolov8::ReleaseSlot(int slot) {
+  {
+    std::lock_guard<std::mutex> lock(slots_lock_);
+    slots_[slot].busy = false;
+  }
+  slots_condition_.notify_one();
+}
+
+void Yolov8::UseNchwOutputs() {
+  native_attrs_.clear();
+  for (uint32_t i = 0; i < app_ctx_.io_num.n_output; i++) {
+    app_ctx_.output_layouts[i].plane =
+        app_ctx_.output_attrs[i].dims[2] * app_ctx_.output_attrs[i].dims[3];
+    app_ctx_.output_layouts[i].c2 = 1;
+  }
+}
+
+bool Yolov8::AllocateSlot(PipelineSlot *slot) {
+  int n_output = app_ctx_.io_num.n_output;
+  slot->input_buffer = std::make_unique<uint8_t[]>(inputs_[0].size);
+  slot->outputs = std::make_unique<rknn_output[]>(n_output);
+  memset(slot->outputs.get(), 0, n_output * sizeof(rknn_output));
+  // fp16的输出保持原来的类型，带宽减半，只转换用到的数值
+  bool want_float = !app_ctx_.is_quant && !app_ctx_.is_fp16;
+  uint32_t elem_size = want_float ? 4 : (app_ctx_.is_fp16 ? 2 : 1);
+  for (int i = 0; i < n_output; i++) {
+    rknn_output &output = slot->outputs[i];
+    output.index = i;
+    if (native_attrs_.empty()) {
+      output.want_float = want_float;
+      output.is_prealloc = 1;
+      output.size = app_ctx_.output_attrs[i].n_elems * elem_size;
+      slot->output_buffers.push_back(
+          std::make_unique<uint8_t[]>(output.size));
+      output.buf = slot->output_buffers.back().get();
+      continue;
+    }
+    rknn_tensor_mem *mem =
+        rknn_create_mem(ctx_, native_attrs_[i].size_with_stride);
+    if (mem == nullptr) {
+      KAYLORDUT_LOG_ERROR("rknn_create_mem for output {} failed", i);
+      return false;
+    }
+    slot->output_mems.push_back(mem);
+    output.buf = mem->virt_addr;
+    output.size = native_attrs_[i].size_with_stride;
+  }
+  return true;
+}
+
+void Yolov8::ReleaseSlots() {
+  for (auto &slot : slots_) {
+    for (auto mem : slot.output_mems) {
+      rknn_destroy_mem(ctx_, mem);
+    }
+  }
+  slots_.clear();
+  bound_slot_ = -1;
+}
+
+// 查询输出的原生布局（NC1HWC2/NHWC），之后把输出绑定到自己分配的内存，
+// 运行时就不需要在CPU上把每个输出转换成NCHW。
+// 宽度有填充或者类型不是int8/fp16时不支持，返回false，继续使用NCHW
+bool Yolov8::SetupNativeOutputs() {
+  int n_output = app_ctx_.io_num.n_output;
+  std::vector<rknn_tensor_attr> native_attrs(n_output);
+  std::vector<tensor_layout_t> layouts(n_output);
+  for (int i = 0; i < n_output; i++) {
+    memset(&native_attrs[i], 0, sizeof(rknn_tensor_attr));
+    native_attrs[i].index = i;
+    int ret = rknn_query(ctx_, RKNN_QUERY_NATIVE_OUTPUT_ATTR, &native_attrs[i],
+                         sizeof(rknn_tensor_attr));
+    if (ret != RKNN_SUCC) {
+      KAYLORDUT_LOG_INFO("native output attr is not available, ret = {}", ret);
+      return false;
+    }
+    const rknn_tensor_attr &attr = app_ctx_.output_attrs[i];
+    const rknn_tensor_attr &native = native_attrs[i];
+    uint32_t channel = attr.dims[1];
+    uint32_t height = attr.dims[2];
+    uint32_t width = attr.dims[3];
+    bool no_padding = native.w_stride == 0 || native.w_stride == width;
+    layouts[i].plane = height * width;
+    rknn_tensor_type type =
+        app_ctx_.is_quant ? RKNN_TENSOR_INT8 : RKNN_TENSOR_FLOAT16;
+    if (native.type != type || !no_padding) {
+      layouts[i].c2 = 0;
+    } else if (native.fmt == RKNN_TENSOR_NC1HWC2 &&
+               native.dims[2] == height && native.dims[3] == width) {
+      layouts[i].c2 = native.dims[4];
+    } else if (native.fmt == RKNN_TENSOR_NHWC && native.dims[1] == height &&
+               native.dims[2] == width) {
+      layouts[i].c2 = channel;
+    } else if (native.fmt == RKNN_TENSOR_NCHW && native.dims[2] == height &&
+               native.dims[3] == width) {
+      layouts[i].c2 = 1;
+    } else {
+      layouts[i].c2 = 0;
+    }
+    if (layouts[i].c2 <= 0) {
+      KAYLORDUT_LOG_INFO("output {} has unsupported native layout {}, type {}",
+                         i, get_format_string(native.fmt),
+                         get_type_string(native.type));
+      return false;
+    }
+  }
+  native_attrs_ = std::move(native_attrs);
+  memcpy(app_ctx_.output_layouts, layouts.data(),
+         n_output * sizeof(tensor_layout_t));
+  for (int i = 0; i < n_output; i++) {
+    KAYLORDUT_LOG_INFO("output {} uses native {} layout, c2 = {}", i,
+                       get_format_string(native_attrs_[i].fmt), layouts[i].c2);
+  }
+  return true;
+}
@@ -6,16 +6,29 @@
 #include "kaylordut/log/logger.h"
 #include "kaylordut/time/run_once.h"
 #include "kaylordut/time/time_duration.h"
+#include "result_sink.h"
 #include "rknn_pool.h"
+#include "segmented_video.h"
 #include "videofile.h"
 
 struct ProgramOptions {
   std::string model_path;
   std::string label_path;
-  std::string input_filename;
+  std::vector<std::string> input_filenames;  // 每个输入文件是一路视频
   int thread_count;
   double framerate;
   bool is_track = false;
+  std::vector<rknn_core_mask> core_masks;
+  // 设置之后进入离线模式：一个输入文件分段并行解码，按帧的顺序输出检测结果
+  std::string output_filename;
+  std::string output_video;  // 可选，按顺序写入绘制之后的视频
+  int decoder_count = 3;
+  int chunk_frames = 64;
+  bool headless = false;  // 不显示，只输出统计
+  // 分割模型的掩码在检测结果中的编码
+  DetectionSink::MaskFormat mask_format = DetectionSink::MaskFormat::RLE;
+  bool parallel_postprocess = false;  // 用空闲的CPU核心并行解码一帧
+  bool pipeline = false;  // 上一帧后处理的时候提交下一帧给NPU
 };
 
 // 检查字符串是否表示有效的数字
@@ -32,15 +45,24 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
   static struct option longOpts[] = {
       {"model_path", required_argument, nullptr, 'm'},
       {"label_path", required_argument, nullptr, 'l'},
+      {"core_mask", required_argument, nullptr, 'c'},
       {"threads", required_argument, nullptr, 't'},
       {"framerate", required_argument, nullptr, 'f'},
       {"input_filename", required_argument, nullptr, 'i'},
       {"help", no_argument, nullptr, 'h'},
       {"track", no_argument, nullptr, 'T'},
+      {"output", required_argument, nullptr, 'o'},
+      {"output_video", required_argument, nullptr, 'O'},
+      {"decoders", required_argument, nullptr, 'D'},
+      {"chunk_frames", required_argument, nullptr, 'C'},
+      {"mask_format", required_argument, nullptr, 'M'},
+      {"headless", no_argument, nullptr, 'H'},
+      {"parallel_postprocess", no_argument, nullptr, 'P'},
+      {"pipeline", no_argument, nullptr, 'A'},
       {nullptr, 0, nullptr, 0}};
 
   int c, optionIndex = 0;
-  while ((c = getopt_long(argc, argv, "m:l:t:f:i:hT", longOpts,
+  while ((c = getopt_long(argc, argv, "m:l:t:f:i:hTc:o:O:D:C:HM:PA", longOpts,
                           &optionIndex)) != -1) {
     switch (c) {
       case 'm':
@@ -49,6 +71,12 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
       case 'l':
         options.label_path = optarg;
         break;
+      case 'c':
+        if (!parse_core_masks(optarg, &options.core_masks)) {
+          KAYLORDUT_LOG_ERROR("Invalid core mask: {}", optarg);
+          return false;
+        }
+        break;
       case 't':
         if (isNumber(optarg)) {
           options.thread_count = std::atoi(optarg);
@@ -74,27 +102,69 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
         }
         break;
       case 'i':
-        options.input_filename = optarg;
+        options.input_filenames.push_back(optarg);
         break;
       case 'h':
         std::cout << "Usage: " << argv[0]
                   << " [--model_path|-m model_path] [--input_filename|-i "
-                     "input_filename] "
+                     "input_filename]... "
                      "[--threads|-t thread_count] [--framerate|-f framerate] "
-                     "[--label_path|-l label_path]\n";
+                     "[--label_path|-l label_path] "
+                     "[--core_mask|-c 0,1,2|0_1|0_1_2|auto] "
+                     "[--output|-o detections.jsonl] "
+                     "[--output_video|-O video] [--decoders|-D count] "
+                     "[--chunk_frames|-C frames] [--mask_format|-M rle|polygon|none] "
+                     "[--headless|-H] [--parallel_postprocess|-P] "
+                     "[--pipeline|-A]\n";
         exit(EXIT_SUCCESS);
       case 'T':
         options.is_track = true;
         break;
+      case 'o':
+        options.output_filename = optarg;
+        break;
+      case 'H':
+        options.headless = true;
+        break;
+      case 'P':
+        options.parallel_postprocess = true;
+        break;
+      case 'A':
+        options.pipeline = true;
+        break;
+      case 'M':
+        if (!parse_mask_format(optarg, &options.mask_format)) {
+          KAYLORDUT_LOG_ERROR("Invalid mask format: {}", optarg);
+          return false;
+        }
+        break;
+      case 'O':
+        options.output_video = optarg;
+        break;
+      case 'D':
+      case 'C':
+        if (!isNumber(optarg) || std::atoi(optarg) <= 0) {
+          KAYLORDUT_LOG_ERROR("Invalid number: {}", optarg);
+          return false;
+        }
+        (c == 'D' ? options.decoder_count : options.chunk_frames) =
+            std::atoi(optarg);
+        break;
       case '?':
         // 错误消息由getopt_long自动处理
         return false;
       default:
         std::cout << "Usage: " << argv[0]
                   << " [--model_path|-d model_path] [--input_filename|-i "
-                     "input_filename] "
+                     "input_filename]... "
                      "[--threads|-t thread_count] [--framerate|-f framerate] "
-                     "[--label_path|-l label_path]\n";
+                     "[--label_path|-l label_path] "
+                     "[--core_mask|-c 0,1,2|0_1|0_1_2|auto] "
+                     "[--output|-o detections.jsonl] "
+                     "[--output_video|-O video] [--decoders|-D count] "
+                     "[--chunk_frames|-C frames] [--mask_format|-M rle|polygon|none] "
+                     "[--headless|-H] [--parallel_postprocess|-P] "
+                     "[--pipeline|-A]\n";
         abort();
     }
   }
@@ -102,51 +172,153 @@ bool parseCommandLine(int argc, char *argv[], ProgramOptions &options) {
   return true;
 }
 
+// 离线模式：多个解码线程并行提交，推理池按帧的序号重新排序之后输出
+int RunOffline(const ProgramOptions &options, RknnPool *rknn_pool) {
+  SegmentedVideo video(options.input_filenames[0], options.decoder_count,
+                       options.chunk_frames,
+                       options.decoder_count * options.chunk_frames);
+  double fps = video.get_fps() > 0 ? video.get_fps() : options.framerate;
+  // 离线处理不能跳过任何一帧，一直等待缺失的帧
+  // 不输出视频时只需要检测结果，不绘制，帧在预处理之后就归还
+  int stream_id = rknn_pool->AddStream(
+      video.get_frame_width(), video.get_frame_height(), options.is_track,
+      fps > 0 ? fps : 30, 1, 0, std::chrono::milliseconds(0),
+      !options.output_video.empty());
+  // 写文件和编码各自在自己的线程里，按结果的顺序输出
+  auto detection_sink = std::make_unique<DetectionSink>(
+      options.output_filename, get_detection_format(options.output_filename),
+      fps);
+  if (!detection_sink->IsOpened()) {
+    return 1;
+  }
+  detection_sink->set_mask_format(options.mask_format);
+  std::unique_ptr<VideoSink> video_sink;
+  if (!options.output_video.empty()) {
+    video_sink = std::make_unique<VideoSink>(
+        options.output_video, fps > 0 ? fps : 30,
+        cv::Size(video.get_frame_width(), video.get_frame_height()));
+    if (!video_sink->IsOpened()) {
+      return 1;
+    }
+  }
+  video.Start([rknn_pool, stream_id](uint64_t index,
+                                     std::shared_ptr<cv::Mat> frame) {
+    rknn_pool->AddInferenceTask(stream_id, std::move(frame), index);
+  });
+  TimeDuration time_duration;
+  uint64_t written = 0;
+  uint64_t frame_count = 0;
+  while (!video.IsFinished(&frame_count) || written < frame_count) {
+    auto image_res = rknn_pool->GetResultFromQueue(stream_id);
+    if (image_res == nullptr) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    // 结果已经按序号排好，超出文件实际长度的帧丢弃
+    uint64_t sequence = image_res->sequence;
+    if (sequence >= written) {
+      if (video_sink != nullptr) {
+        video_sink->Push(image_res);
+      }
+      detection_sink->Push(std::move(image_res));
+      written = sequence + 1;
+    }
+    video.Consume(sequence);
+  }
+  // 等待输出全部写完
+  video_sink.reset();
+  detection_sink.reset();
+  auto time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      time_duration.DurationSinceLastTime());
+  KAYLORDUT_LOG_INFO("Process {} frames in {}ms, average frame rate is {}fps",
+                     written, time.count(),
+                     written * 1000.0 / std::max<int64_t>(1, time.count()));
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
   KAYLORDUT_LOG_INFO("Yolov8 demo for rk3588");
-  ProgramOptions options = {"", "", "", 0, 0.0};
+  ProgramOptions options = {"", "", {}, 0, 0.0};
   if (!parseCommandLine(argc, argv, options)) {
     KAYLORDUT_LOG_ERROR("Parse command failed.");
     return 1;
   }
-  if (options.framerate == 0.0 || options.thread_count == 0 ||
-      options.label_path.empty() || options.input_filename.empty() ||
+  // 离线模式使用视频文件的帧率，不需要--framerate
+  bool offline = !options.output_filename.empty();
+  if ((options.framerate == 0.0 && !offline) || options.thread_count == 0 ||
+      options.label_path.empty() || options.input_filenames.empty() ||
       options.model_path.empty()) {
     KAYLORDUT_LOG_ERROR("Missing required options. Use --help for help.");
     return 1;
   }
+  if (offline && options.input_filenames.size() != 1) {
+    KAYLORDUT_LOG_ERROR("Offline mode takes exactly one input file.");
+    return 1;
+  }
   auto rknn_pool = std::make_unique<RknnPool>(
-      options.model_path, options.thread_count, options.label_path);
-  VideoFile video_file(options.input_filename.c_str());
+      options.model_path, options.thread_count, options.label_path,
+      options.core_masks);
+  // 先确定流水线的深度，辅助线程的数量取决于推理线程的数量
+  if (options.pipeline) {
+    rknn_pool->SetPipelineDepth(2);
+  }
+  bool parallel_postprocess =
+      options.parallel_postprocess && rknn_pool->SetParallelPostProcess(true);
+  if (offline) {
+    int ret = RunOffline(options, rknn_pool.get());
+    rknn_pool.reset();
+    return ret;
+  }
+  // 多个输入文件共用一个推理池，每个文件注册为一路视频
+  std::vector<std::unique_ptr<VideoFile>> video_files;
+  std::vector<int> stream_ids;
+  // 所有的窗口由同一个显示线程负责，来不及显示的帧直接丢弃，不会拖慢推理
+  std::unique_ptr<DisplaySink> display_sink;
+  if (!options.headless) {
+    display_sink = std::make_unique<DisplaySink>(
+        "Video", options.input_filenames.size());
+  }
+  for (size_t i = 0; i < options.input_filenames.size(); ++i) {
+    video_files.push_back(
+        std::make_unique<VideoFile>(options.input_filenames[i].c_str()));
+    stream_ids.push_back(rknn_pool->AddStream(
+        video_files[i]->get_frame_width(), video_files[i]->get_frame_height(),
+        options.is_track, options.framerate, 1, 0,
+        std::chrono::milliseconds(500), !options.headless));
+  }
   int delay = 1000 / options.framerate;
-  ImageProcess image_process(video_file.get_frame_width(),
-                             video_file.get_frame_height(), 640,
-                             options.is_track, options.framerate);
-  std::unique_ptr<cv::Mat> image;
-  std::shared_ptr<cv::Mat> image_res;
+  std::shared_ptr<cv::Mat> image;
+  std::shared_ptr<InferenceResult> image_res;
   uint8_t running_flag = 0;
-  cv::namedWindow("Video", cv::WINDOW_AUTOSIZE);
   static int image_count = 0;
   static int image_res_count = 0;
   TimeDuration time_duration;
   do {
     auto func = [&] {
       running_flag = 0;
-      image = video_file.GetNextFrame();
-      if (image != nullptr) {
-        rknn_pool->AddInferenceTask(std::move(image), image_process);
-        running_flag |= 0x01;
-        image_count++;
+      for (size_t i = 0; i < video_files.size(); ++i) {
+        // 解码在后台线程中进行，这里只取已经解码好的帧，不会长时间阻塞
+        image = video_files[i]->GetNextFrame(std::chrono::milliseconds(0));
+        if (image != nullptr) {
+          rknn_pool->AddInferenceTask(stream_ids[i], std::move(image));
+          image_count++;
+        }
+        if (!video_files[i]->IsEnd()) {
+          running_flag |= 0x01;
+        }
       }
-      image_res = rknn_pool->GetImageResultFromQueue();
-      if (image_res != nullptr) {
-        cv::imshow("Video", *image_res);
-        image_res_count++;
-        KAYLORDUT_LOG_INFO("image count = {}, image res count = {}, delta = {}",
-                           image_count, image_res_count,
-                           image_count - image_res_count);
-        cv::waitKey(1);
-        running_flag |= 0x10;
+      for (size_t i = 0; i < video_files.size(); ++i) {
+        image_res = rknn_pool->GetResultFromQueue(stream_ids[i]);
+        if (image_res != nullptr) {
+          if (display_sink != nullptr) {
+            display_sink->Push(std::move(image_res));
+          }
+          image_res_count++;
+          KAYLORDUT_LOG_INFO(
+              "image count = {}, image res count = {}, delta = {}",
+              image_count, image_res_count, image_count - image_res_count);
+          running_flag |= 0x10;
+        }
       }
     };
     run_once_with_delay(func, std::chrono::milliseconds(delay));
@@ -159,8 +331,16 @@ int main(int argc, char *argv[]) {
   double fps = image_res_count * 1000.0 / time.count();
   KAYLORDUT_LOG_INFO("Total time is {}ms, and average frame rate is {}fps",
                      time.count(), fps);
+  for (size_t i = 0; i < stream_ids.size(); ++i) {
+    auto stats = rknn_pool->GetStreamStats(stream_ids[i]);
+    KAYLORDUT_LOG_INFO(
+        "stream {}: {} frames, fps is {}, latency is {}ms, dropped {} frames, "
+        "parallel post process is {}",
+        stream_ids[i], stats.frames, stats.fps, stats.latency_ms,
+        stats.dropped, parallel_postprocess ? "on" : "off");
+  }
+  display_sink.reset();
   rknn_pool.reset();
   KAYLORDUT_LOG_INFO("exit loop");
-  cv::destroyAllWindows();
   return 0;
 }
\ No newline at end of file